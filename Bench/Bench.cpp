@@ -0,0 +1,242 @@
+/*
+  ==============================================================================
+
+    Bench.cpp
+    one host and N tracks in the same process, without a DAW or any editor.
+    reports how long the tracks take to register, how long a dsp update takes
+    to reach every track's audio, and the audio thread cost of the tracks.
+
+    usage : MixTrainer_Bench [track counts...], 16 64 256 1024 4096 by default
+    the shared memory segment is private to the bench, a DAW session running meanwhile isn't disturbed.
+    also checks that the host reclaims the meter slot of a track which stopped beating, exits with 1 if not
+
+  ==============================================================================
+*/
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#include "../shared/shared.h"
+#include "../shared/shared_ui.h"
+#include "../shared/transport.h"
+#include "../shared/audio.h"
+#include "../Game/Game.h"
+#include "../Game/Game_UI.h"
+#include "../Game/Game_Mixer.h"
+#include "../Plugin_Host/Main_Menu.h"
+#include "../Plugin_Host/Application.h"
+#include "../Plugin_Host/Processor_Host.h"
+#include "../Plugin_Track/Processor_Track.h"
+
+static constexpr double bench_sample_rate = 48000.0;
+static constexpr int bench_block_size = 512;
+static constexpr int bench_update_count = 20;
+static constexpr int bench_audio_block_count = 200;
+
+struct Bench_Result
+{
+    int track_count;
+    int game_channel_count;
+    bool is_registered;
+    double registration_ms;
+    int received_update_count;
+    double update_latency_mean_ms;
+    double update_latency_max_ms;
+    double audio_block_ms;
+    double audio_cpu_percent;
+};
+
+//runs the message loop until the condition holds, false on timeout
+static bool bench_pump_until(const std::function<bool()> &condition, double timeout_ms)
+{
+    double start = juce::Time::getMillisecondCounterHiRes();
+    while (!condition())
+    {
+        if (juce::Time::getMillisecondCounterHiRes() - start > timeout_ms)
+            return false;
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(1);
+    }
+    return true;
+}
+
+static void bench_fill_noise(juce::AudioBuffer<float> *buffer, juce::Random *random)
+{
+    for (int channel = 0; channel < buffer->getNumChannels(); channel++)
+    {
+        float *samples = buffer->getWritePointer(channel);
+        for (int i = 0; i < buffer->getNumSamples(); i++)
+            samples[i] = random->nextFloat() * 0.5f - 0.25f;
+    }
+}
+
+//a track process which was killed keeps its slot claimed, only its heartbeat stops
+static bool bench_check_stale_meter_slot()
+{
+    auto host = transport_open(Transport_Role_Host);
+    if (!host)
+        return false;
+    auto track = transport_open(Transport_Role_Track);
+    if (!track)
+    {
+        transport_close(host.get());
+        return false;
+    }
+    int32_t live_slot = transport_claim_meter_slot(track.get(), 1);
+    int32_t killed_slot = transport_claim_meter_slot(track.get(), 2);
+    assert(live_slot != -1 && killed_slot != -1);
+    std::atomic<int64_t> *killed_heartbeat = &track->block->meter_slots[killed_slot].heartbeat_ms;
+    killed_heartbeat->store(killed_heartbeat->load() - transport_meter_slot_timeout_ms - 1);
+
+    bool is_reclaimed = transport_reclaim_stale_meter_slots(host.get()) == 1
+        && transport_beat_meter_slot(track.get(), live_slot, 1)
+        && !transport_beat_meter_slot(track.get(), killed_slot, 2);
+    auto levels = transport_read_track_levels(host.get());
+    is_reclaimed = is_reclaimed && levels.size() == 1 && levels[0].daw_channel_id == 1;
+
+    //a track which lost its slot to the host and goes away late doesn't free the slot of the track holding it now
+    int32_t other_slot = transport_claim_meter_slot(track.get(), 3);
+    assert(other_slot != -1);
+    transport_release_meter_slot(track.get(), other_slot, 2);
+    is_reclaimed = is_reclaimed && transport_read_track_levels(host.get()).size() == 2;
+
+    transport_release_meter_slot(track.get(), other_slot, 3);
+    transport_release_meter_slot(track.get(), live_slot, 1);
+    transport_close(track.get());
+    transport_close(host.get());
+    return is_reclaimed;
+}
+
+static Bench_Result bench_run(int track_count)
+{
+    Bench_Result result = { .track_count = track_count };
+    juce::Random random { 1234 };
+    juce::MidiBuffer midi;
+
+    auto host = std::make_unique<ProcessorHost>();
+    host->prepareToPlay(bench_sample_rate, bench_block_size);
+
+    int game_channel_count = track_count;
+    result.game_channel_count = game_channel_count;
+    std::vector<Game_Channel> game_channels;
+    for (int i = 0; i < game_channel_count; i++)
+    {
+        Game_Channel channel = { .id = checked_cast<uint32_t>(i), .min_freq = 20.0f, .max_freq = 20000.0f };
+        snprintf(channel.name, sizeof(channel.name), "Channel %d", i + 1);
+        game_channels.push_back(channel);
+    }
+    host->app.set_model(game_channels);
+
+    //registration : from the first track constructed to the host knowing all of them
+    double registration_start = juce::Time::getMillisecondCounterHiRes();
+    std::vector<std::unique_ptr<ProcessorTrack>> tracks;
+    tracks.reserve(checked_cast<size_t>(track_count));
+    for (int i = 0; i < track_count; i++)
+        tracks.push_back(std::make_unique<ProcessorTrack>());
+    result.is_registered = bench_pump_until([&] {
+        return std::all_of(tracks.begin(), tracks.end(), [&](const auto &track) {
+            return host->app.has_daw_channel(track->daw_channel_id);
+        });
+    }, 10000.0);
+    result.registration_ms = juce::Time::getMillisecondCounterHiRes() - registration_start;
+
+    std::vector<juce::AudioBuffer<float>> buffers;
+    buffers.reserve(tracks.size());
+    for (size_t i = 0; i < tracks.size(); i++)
+    {
+        tracks[i]->prepareToPlay(bench_sample_rate, bench_block_size);
+        tracks[i]->game_channel_id = game_channels[i % game_channels.size()].id;
+        tracks[i]->broadcast_selected_game_channel();
+        buffers.emplace_back(2, bench_block_size);
+    }
+    juce::MessageManager::getInstance()->runDispatchLoopUntil(100);
+
+    auto process_tracks = [&] {
+        for (size_t i = 0; i < tracks.size(); i++)
+            tracks[i]->processBlock(buffers[i], midi);
+    };
+
+    //update latency : one change to every game channel, until every track runs it on its audio
+    double latency_total = 0.0;
+    for (int update = 0; update < bench_update_count; update++)
+    {
+        double gain_db = -1.0 - (update % 12);
+        std::unordered_map<uint32_t, Channel_DSP_State> dsp_states;
+        for (const auto &channel : game_channels)
+            dsp_states.emplace(channel.id, ChannelDSP_gain_db(gain_db));
+
+        double start = juce::Time::getMillisecondCounterHiRes();
+        host->broadcastAllDSP(dsp_states);
+        bool is_applied = bench_pump_until([&] {
+            process_tracks();
+            return std::all_of(tracks.begin(), tracks.end(), [&](const auto &track) {
+                return track->applied_dsp.gain_db == gain_db;
+            });
+        }, 2000.0);
+        if (!is_applied)
+            continue;
+        double latency = juce::Time::getMillisecondCounterHiRes() - start;
+        result.received_update_count++;
+        latency_total += latency;
+        result.update_latency_max_ms = std::max(result.update_latency_max_ms, latency);
+    }
+    if (result.received_update_count > 0)
+        result.update_latency_mean_ms = latency_total / result.received_update_count;
+
+    //audio thread cost : every track's processBlock, back to back, with the noise refilled outside of the timing
+    double audio_total = 0.0;
+    for (int block = 0; block < bench_audio_block_count; block++)
+    {
+        for (auto &buffer : buffers)
+            bench_fill_noise(&buffer, &random);
+        double start = juce::Time::getMillisecondCounterHiRes();
+        process_tracks();
+        audio_total += juce::Time::getMillisecondCounterHiRes() - start;
+    }
+    result.audio_block_ms = audio_total / bench_audio_block_count;
+    result.audio_cpu_percent = 100.0 * result.audio_block_ms / (1000.0 * bench_block_size / bench_sample_rate);
+
+    //the tracks send their delete before the host goes away
+    tracks.clear();
+    juce::MessageManager::getInstance()->runDispatchLoopUntil(50);
+    host.reset();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juce_initialiser;
+
+    std::vector<int> track_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        int count = atoi(argv[i]);
+        if (count > 0)
+            track_counts.push_back(count);
+    }
+    if (track_counts.empty())
+        track_counts = { 16, 64, 256, 1024, 4096 };
+
+    bool is_stale_meter_slot_reclaimed = bench_check_stale_meter_slot();
+    printf("stale meter slot reclaimed : %s\n", is_stale_meter_slot_reclaimed ? "yes" : "no");
+
+    printf("%d Hz, %d samples per block\n", static_cast<int>(bench_sample_rate), bench_block_size);
+    printf("%8s %8s %16s %12s %14s %13s %12s %8s\n",
+           "tracks", "channels", "registration ms", "updates", "latency ms", "latency max", "block ms", "cpu %");
+    for (int track_count : track_counts)
+    {
+        Bench_Result result = bench_run(track_count);
+        printf("%8d %8d %16.2f %9d/%-2d %14.2f %13.2f %12.3f %8.1f%s\n",
+               result.track_count,
+               result.game_channel_count,
+               result.registration_ms,
+               result.received_update_count,
+               bench_update_count,
+               result.update_latency_mean_ms,
+               result.update_latency_max_ms,
+               result.audio_block_ms,
+               result.audio_cpu_percent,
+               result.is_registered ? "" : "  (not every track registered)");
+        fflush(stdout);
+    }
+    transport_remove_private_segment();
+    return is_stale_meter_slot_reclaimed ? 0 : 1;
+}
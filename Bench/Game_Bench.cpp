@@ -0,0 +1,506 @@
+/*
+  ==============================================================================
+
+    Game_Bench.cpp
+    runs the update functions of the three games for millions of events, without a thread,
+    a ui or any audio. a synthetic player answers each question after latency ms, correctly
+    with the given accuracy, a timer tick is processed whenever the game's deadline comes first.
+    reports the time and the heap allocations per event, and checks them against a baseline.
+
+    usage : MixTrainer_Game_Bench [--events N] [--accuracy 0..1] [--latency-ms N]
+                                  [--output results.csv] [--baseline results.csv]
+    the output is appended to, the baseline is a previous output, the last line of each game is used.
+    exits with 1 when a game is slower, or allocates more, than in the baseline
+
+  ==============================================================================
+*/
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#include "../shared/shared.h"
+#include "../shared/shared_ui.h"
+#include "../Game/Game.h"
+#include "../Game/Game_UI.h"
+#include "../Game/Frequency_Game.h"
+#include "../Game/Frequency_Game_UI.h"
+#include "../Game/Compressor_Game.h"
+#include "../Game/Game_Mixer.h"
+
+//every allocation of the process goes through here, the bench is single threaded
+static std::atomic<uint64_t> bench_allocation_count { 0 };
+
+void *operator new(std::size_t size)
+{
+    bench_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+static constexpr int64_t bench_default_event_count = 2000000;
+//between the player's gestures that aren't an answer : begin, next, a slider, a toggle
+static constexpr int64_t bench_gesture_ms = 120;
+static constexpr uint32_t bench_file_count = 16;
+static constexpr uint32_t bench_mixer_channel_count = 8;
+//a run slower than the baseline by more than this fails
+static constexpr double bench_time_tolerance = 0.10;
+//the player is waiting for the game, only a deadline moves it forward
+static constexpr int64_t bench_waiting = std::numeric_limits<int64_t>::max();
+
+struct Bench_Options
+{
+    int64_t event_count;
+    float accuracy;
+    int64_t latency_ms;
+    juce::File output_file;
+    juce::File baseline_file;
+};
+
+struct Bench_Player
+{
+    juce::Random random;
+    float accuracy;
+    int64_t latency_ms;
+    int64_t now;
+    //the question the answer was drawn for
+    int64_t drawn_question_timestamp;
+    bool is_correct;
+};
+
+struct Bench_Result
+{
+    std::string game;
+    int64_t event_count;
+    int64_t tick_count;
+    int64_t answer_count;
+    int64_t error_count;
+    uint64_t allocation_count;
+    double elapsed_ms;
+};
+
+static Event bench_event(Event_Type type, int64_t timestamp)
+{
+    return Event { .type = type, .timestamp = timestamp };
+}
+
+//drawn once per question, so that every gesture of a question aims at the same answer
+static bool bench_player_is_correct(Bench_Player *player, int64_t question_timestamp)
+{
+    if (player->drawn_question_timestamp != question_timestamp)
+    {
+        player->drawn_question_timestamp = question_timestamp;
+        player->is_correct = player->random.nextFloat() < player->accuracy;
+    }
+    return player->is_correct;
+}
+
+static int64_t bench_answer_time(const Bench_Player *player, int64_t question_timestamp)
+{
+    return std::max(player->now + bench_gesture_ms, question_timestamp + player->latency_ms);
+}
+
+//the part of the game thread : the deadline wins over the player's next event when it comes first.
+//player_fn returns the player's next event, update_fn processes one event and returns its error,
+//deadline_fn returns the game's deadline, -1 when nothing is due
+template<typename Player_Fn, typename Update_Fn, typename Deadline_Fn>
+static void bench_drive(Bench_Result *result, Bench_Player *player, int64_t event_count,
+                        Player_Fn player_fn, Update_Fn update_fn, Deadline_Fn deadline_fn)
+{
+    uint64_t allocation_start = bench_allocation_count.load(std::memory_order_relaxed);
+    double start = juce::Time::getMillisecondCounterHiRes();
+    for (int64_t i = 0; i < event_count; i++)
+    {
+        Event event = player_fn(player);
+        juce::int64 deadline = deadline_fn();
+        if (deadline != -1 && deadline <= event.timestamp)
+        {
+            event = Event { .type = Event_Timer_Tick, .value_i64 = deadline, .timestamp = deadline };
+            result->tick_count++;
+        }
+        else if (event.type == Event_Click_Frequency || event.type == Event_Click_Answer)
+            result->answer_count++;
+        assert(event.timestamp != bench_waiting);
+        player->now = event.timestamp;
+        if (update_fn(std::move(event)) != 0)
+            result->error_count++;
+    }
+    result->elapsed_ms = juce::Time::getMillisecondCounterHiRes() - start;
+    result->allocation_count = bench_allocation_count.load(std::memory_order_relaxed) - allocation_start;
+    result->event_count = event_count;
+}
+
+static std::vector<Audio_File> bench_files()
+{
+    std::vector<Audio_File> files;
+    for (uint32_t i = 0; i < bench_file_count; i++)
+    {
+        files.push_back(Audio_File {
+            .is_valid = true,
+            .file = {},
+            .title = "File " + std::to_string(i + 1),
+            .loop_bounds_ms = { 0, 60000 },
+            .freq_bounds = {},
+            .max_level = 1.0f,
+            .file_length_ms = 60000,
+            .hash = int64_t(i + 1)
+        });
+    }
+    return files;
+}
+
+static Bench_Result bench_frequency_game(const Bench_Options &options)
+{
+    Bench_Result result = { .game = "frequency" };
+    Bench_Player player = { .random = juce::Random(1), .accuracy = options.accuracy, .latency_ms = options.latency_ms, .drawn_question_timestamp = -1 };
+    auto files = bench_files();
+    auto context = frequency_game_context_init(frequency_game_config_default("Bench"), &files);
+    const FrequencyGame_Config &config = context->config;
+    FrequencyGame_State state = frequency_game_state_init(1);
+    auto update = [&] (Event event) {
+        Frequency_Game_Effects effects = frequency_game_update(context.get(), state, std::move(event));
+        state = effects.new_state;
+        return effects.error;
+    };
+    update(bench_event(Event_Init, 0));
+    update(bench_event(Event_Create_UI, 0));
+
+    auto frequency_player = [&] (Bench_Player *player) -> Event {
+        switch (state.step)
+        {
+            case GameStep_Begin :
+                return bench_event(Event_Click_Begin, player->now + bench_gesture_ms);
+            case GameStep_Question :
+            {
+                if (state.is_prelistening)
+                    return bench_event(Event_Click_Frequency, bench_waiting);
+                uint32_t answer = state.target_frequency;
+                if (!bench_player_is_correct(player, state.question_timestamp))
+                {
+                    float target_ratio = normalize_frequency(state.target_frequency, config.min_f, config.num_octaves);
+                    answer = denormalize_frequency(std::fmod(target_ratio + 0.5f, 1.0f), config.min_f, config.num_octaves);
+                }
+                Event event = bench_event(Event_Click_Frequency, bench_answer_time(player, state.question_timestamp));
+                event.value_u = answer;
+                return event;
+            }
+            case GameStep_Result :
+                return bench_event(Event_Click_Next, player->now + bench_gesture_ms);
+            case GameStep_EndResults :
+            case GameStep_None :
+            default :
+                return bench_event(Event_Init, player->now + bench_gesture_ms);
+        }
+    };
+    bench_drive(&result, &player, options.event_count, frequency_player, update, [&] {
+        return frequency_game_next_deadline(context.get(), state);
+    });
+    return result;
+}
+
+static Bench_Result bench_compressor_game(const Bench_Options &options)
+{
+    Bench_Result result = { .game = "compressor" };
+    Bench_Player player = { .random = juce::Random(2), .accuracy = options.accuracy, .latency_ms = options.latency_ms, .drawn_question_timestamp = -1 };
+    auto files = bench_files();
+    CompressorGame_Config config = compressor_game_config_default("Bench");
+    config.threshold_active = true;
+    config.ratio_active = true;
+    config.attack_active = true;
+    config.release_active = true;
+    compressor_game_config_validate(&config);
+    auto context = compressor_game_context_init(std::move(config), &files);
+    CompressorGame_State state = compressor_game_state_init(2);
+    auto update = [&] (Event event) {
+        Compressor_Game_Effects effects = compressor_game_update(context.get(), state, std::move(event));
+        state = effects.new_state;
+        return effects.error;
+    };
+    update(bench_event(Event_Init, 0));
+    update(bench_event(Event_Create_UI, 0));
+
+    auto compressor_player = [&] (Bench_Player *player) -> Event {
+        switch (state.step)
+        {
+            case GameStep_Begin :
+                return bench_event(Event_Click_Begin, player->now + bench_gesture_ms);
+            case GameStep_Question :
+            {
+                if (state.mix == Mix_Target)
+                {
+                    if (!state.can_still_listen || context->config.variant == Compressor_Game_Timer)
+                        return bench_event(Event_Toggle_Input_Target, bench_waiting);
+                    return bench_event(Event_Toggle_Input_Target, player->now + bench_gesture_ms);
+                }
+                bool is_correct = bench_player_is_correct(player, state.question_timestamp);
+                uint32_t targets[4] = { state.target_threshold_pos, state.target_ratio_pos, state.target_attack_pos, state.target_release_pos };
+                uint32_t inputs[4] = { state.input_threshold_pos, state.input_ratio_pos, state.input_attack_pos, state.input_release_pos };
+                size_t sizes[4] = {
+                    context->config.threshold_values_db.size(),
+                    context->config.ratio_values.size(),
+                    context->config.attack_values.size(),
+                    context->config.release_values.size()
+                };
+                for (int i = 0; i < 4; i++)
+                {
+                    uint32_t wanted = is_correct ? targets[i] : (targets[i] + 1) % checked_cast<uint32_t>(sizes[i]);
+                    if (inputs[i] == wanted)
+                        continue;
+                    Event event = bench_event(Event_Slider, player->now + bench_gesture_ms);
+                    event.id = i;
+                    event.value_u = wanted;
+                    return event;
+                }
+                return bench_event(Event_Click_Answer, bench_answer_time(player, state.question_timestamp));
+            }
+            case GameStep_Result :
+                return bench_event(Event_Click_Next, player->now + bench_gesture_ms);
+            case GameStep_EndResults :
+            case GameStep_None :
+            default :
+                return bench_event(Event_Init, player->now + bench_gesture_ms);
+        }
+    };
+    bench_drive(&result, &player, options.event_count, compressor_player, update, [&] {
+        return compressor_game_next_deadline(context.get(), state);
+    });
+    return result;
+}
+
+static Bench_Result bench_mixer_game(const Bench_Options &options)
+{
+    Bench_Result result = { .game = "mixer" };
+    Bench_Player player = { .random = juce::Random(3), .accuracy = options.accuracy, .latency_ms = options.latency_ms, .drawn_question_timestamp = -1 };
+    std::vector<Game_Channel> channels;
+    for (uint32_t i = 0; i < bench_mixer_channel_count; i++)
+    {
+        Game_Channel channel = { .id = i, .min_freq = 20.0f, .max_freq = 20000.0f };
+        snprintf(channel.name, sizeof(channel.name), "Channel %u", i + 1);
+        channels.push_back(channel);
+    }
+    MixerGame_State state = mixer_game_state_init(std::move(channels), MixerGame_Normal, -1, -1, { -100.0, -12.0, -9.0, -6.0, -3.0 }, 3);
+    auto update = [&] (Event event) {
+        //copied in and out, as the game thread does
+        Game_Mixer_Effects effects = mixer_game_update(state, std::move(event));
+        state = effects.new_state;
+        return effects.error;
+    };
+    update(bench_event(Event_Init, 0));
+    update(bench_event(Event_Create_UI, 0));
+
+    auto mixer_player = [&] (Bench_Player *player) -> Event {
+        switch (state.step)
+        {
+            case GameStep_Begin :
+                return bench_event(Event_Click_Begin, player->now + bench_gesture_ms);
+            case GameStep_Question :
+            {
+                if (state.mix == Mix_Target)
+                {
+                    if (!state.can_still_listen || state.config.variant == MixerGame_Timer)
+                        return bench_event(Event_Toggle_Input_Target, bench_waiting);
+                    return bench_event(Event_Toggle_Input_Target, player->now + bench_gesture_ms);
+                }
+                bool is_correct = bench_player_is_correct(player, state.question_timestamp);
+                auto position_count = checked_cast<uint32_t>(state.config.db_slider_values.size());
+                for (size_t i = 0; i < state.target_slider_pos.size(); i++)
+                {
+                    uint32_t wanted = is_correct ? state.target_slider_pos[i] : (state.target_slider_pos[i] + 1) % position_count;
+                    if (state.edited_slider_pos[i] == wanted)
+                        continue;
+                    Event event = bench_event(Event_Slider, player->now + bench_gesture_ms);
+                    event.id = checked_cast<int>(i);
+                    event.value_i = checked_cast<int>(wanted);
+                    return event;
+                }
+                return bench_event(Event_Click_Answer, bench_answer_time(player, state.question_timestamp));
+            }
+            case GameStep_Result :
+                return bench_event(Event_Click_Next, player->now + bench_gesture_ms);
+            case GameStep_EndResults :
+            case GameStep_None :
+            default :
+                return bench_event(Event_Init, player->now + bench_gesture_ms);
+        }
+    };
+    bench_drive(&result, &player, options.event_count, mixer_player, update, [&] {
+        return mixer_game_next_deadline(state);
+    });
+    return result;
+}
+
+static double bench_ns_per_event(const Bench_Result &result)
+{
+    return result.event_count > 0 ? result.elapsed_ms * 1e6 / double(result.event_count) : 0.0;
+}
+
+static double bench_allocations_per_event(const Bench_Result &result)
+{
+    return result.event_count > 0 ? double(result.allocation_count) / double(result.event_count) : 0.0;
+}
+
+static const char *bench_csv_header = "timestamp,game,events,accuracy,latency_ms,ns_per_event,allocations_per_event,ticks,answers,errors";
+
+static std::string bench_csv_line(const Bench_Result &result, const Bench_Options &options, int64_t timestamp)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%lld,%s,%lld,%.3f,%lld,%.2f,%.4f,%lld,%lld,%lld",
+             (long long)timestamp,
+             result.game.c_str(),
+             (long long)result.event_count,
+             (double)options.accuracy,
+             (long long)options.latency_ms,
+             bench_ns_per_event(result),
+             bench_allocations_per_event(result),
+             (long long)result.tick_count,
+             (long long)result.answer_count,
+             (long long)result.error_count);
+    return line;
+}
+
+struct Bench_Baseline
+{
+    std::string game;
+    double ns_per_event;
+    double allocations_per_event;
+};
+
+//the last line of each game
+static std::vector<Bench_Baseline> bench_read_baseline(juce::File file)
+{
+    std::vector<Bench_Baseline> baselines;
+    juce::StringArray lines;
+    file.readLines(lines);
+    for (const auto &line : lines)
+    {
+        juce::StringArray fields = juce::StringArray::fromTokens(line, ",", "");
+        if (fields.size() < 7 || fields[0] == "timestamp")
+            continue;
+        Bench_Baseline baseline = {
+            .game = fields[1].toStdString(),
+            .ns_per_event = fields[5].getDoubleValue(),
+            .allocations_per_event = fields[6].getDoubleValue()
+        };
+        auto it = std::find_if(baselines.begin(), baselines.end(), [&] (const Bench_Baseline &b) { return b.game == baseline.game; });
+        if (it != baselines.end())
+            *it = baseline;
+        else
+            baselines.push_back(baseline);
+    }
+    return baselines;
+}
+
+static bool bench_parse_options(int argc, char *argv[], Bench_Options *options)
+{
+    *options = {
+        .event_count = bench_default_event_count,
+        .accuracy = 0.8f,
+        .latency_ms = 1500,
+        .output_file = {},
+        .baseline_file = {}
+    };
+    auto working_directory = juce::File::getCurrentWorkingDirectory();
+    for (int i = 1; i < argc; i++)
+    {
+        juce::String argument = argv[i];
+        if (i + 1 == argc)
+            return false;
+        juce::String value = argv[++i];
+        if (argument == "--events")
+            options->event_count = std::max<int64_t>(1, value.getLargeIntValue());
+        else if (argument == "--accuracy")
+            options->accuracy = std::clamp(value.getFloatValue(), 0.0f, 1.0f);
+        else if (argument == "--latency-ms")
+            options->latency_ms = std::max<int64_t>(0, value.getLargeIntValue());
+        else if (argument == "--output")
+            options->output_file = working_directory.getChildFile(value);
+        else if (argument == "--baseline")
+            options->baseline_file = working_directory.getChildFile(value);
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juce_initialiser;
+
+    Bench_Options options;
+    if (!bench_parse_options(argc, argv, &options))
+    {
+        printf("usage : MixTrainer_Game_Bench [--events N] [--accuracy 0..1] [--latency-ms N] [--output results.csv] [--baseline results.csv]\n");
+        return 1;
+    }
+
+    printf("%lld events per game, accuracy %.2f, answers after %lld ms\n",
+           (long long)options.event_count, (double)options.accuracy, (long long)options.latency_ms);
+    printf("%-12s %12s %14s %12s %12s %8s\n", "game", "ns/event", "allocs/event", "ticks", "answers", "errors");
+
+    std::vector<Bench_Result> results;
+    results.push_back(bench_frequency_game(options));
+    results.push_back(bench_compressor_game(options));
+    results.push_back(bench_mixer_game(options));
+    for (const auto &result : results)
+    {
+        printf("%-12s %12.1f %14.3f %12lld %12lld %8lld\n",
+               result.game.c_str(),
+               bench_ns_per_event(result),
+               bench_allocations_per_event(result),
+               (long long)result.tick_count,
+               (long long)result.answer_count,
+               (long long)result.error_count);
+    }
+    fflush(stdout);
+
+    bool is_regression = false;
+    if (options.baseline_file != juce::File{})
+    {
+        auto baselines = bench_read_baseline(options.baseline_file);
+        for (const auto &result : results)
+        {
+            auto it = std::find_if(baselines.begin(), baselines.end(), [&] (const Bench_Baseline &b) { return b.game == result.game; });
+            if (it == baselines.end())
+                continue;
+            //allocations are exact, the time is given some noise
+            if (bench_allocations_per_event(result) > it->allocations_per_event + 0.0005)
+            {
+                printf("%s allocates more : %.4f per event, %.4f in the baseline\n",
+                       result.game.c_str(), bench_allocations_per_event(result), it->allocations_per_event);
+                is_regression = true;
+            }
+            if (bench_ns_per_event(result) > it->ns_per_event * (1.0 + bench_time_tolerance))
+            {
+                printf("%s is slower : %.1f ns per event, %.1f ns in the baseline\n",
+                       result.game.c_str(), bench_ns_per_event(result), it->ns_per_event);
+                is_regression = true;
+            }
+        }
+    }
+
+    if (options.output_file != juce::File{})
+    {
+        bool is_new = !options.output_file.existsAsFile();
+        juce::FileOutputStream stream { options.output_file };
+        if (!stream.openedOk())
+        {
+            printf("couldn't open %s\n", options.output_file.getFullPathName().toRawUTF8());
+            return 1;
+        }
+        if (is_new)
+            stream << bench_csv_header << "\n";
+        int64_t timestamp = juce::Time::currentTimeMillis();
+        for (const auto &result : results)
+            stream << juce::String(bench_csv_line(result, options, timestamp)) << "\n";
+    }
+    return is_regression ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    Replay.cpp
+    feeds the recordings made with MIXTRAINER_RECORDINGS set back through the game
+    updates, as fast as they go, without a thread, a ui or any audio.
+    the effects of every event are compared with the digest recorded alongside it,
+    the first event that doesn't produce the recorded effects is reported.
+
+    usage : MixTrainer_Replay <recording files...>
+    exits with 1 when a recording can't be read or doesn't replay identically
+
+  ==============================================================================
+*/
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#include "../shared/shared.h"
+#include "../shared/shared_ui.h"
+#include "../Game/Game.h"
+#include "../Game/Game_UI.h"
+#include "../Game/Frequency_Game.h"
+#include "../Game/Compressor_Game.h"
+#include "../Game/Game_Mixer.h"
+
+struct Replay_Result
+{
+    bool is_read;
+    size_t event_count;
+    //-1 when every event produced the recorded effects
+    int64_t first_divergence;
+    uint32_t first_divergence_type;
+    size_t divergence_count;
+    //updates and digests
+    double elapsed_ms;
+};
+
+static const char *replay_game_names[] = { "none", "frequency", "compressor", "mixer" };
+
+//update_fn runs one event and returns the digest of its effects
+template<typename Update_Fn>
+static void replay_events(const Recording &recording, Replay_Result *result, Update_Fn update_fn)
+{
+    double start = juce::Time::getMillisecondCounterHiRes();
+    for (size_t i = 0; i < recording.events.size(); i++)
+    {
+        const Recorded_Event &recorded = recording.events[i];
+        uint64_t digest = update_fn(recorded_event_to_event(recorded));
+        if (digest == recorded.effects_digest)
+            continue;
+        //everything after the first divergence replays from a different state
+        if (result->first_divergence == -1)
+        {
+            result->first_divergence = checked_cast<int64_t>(i);
+            result->first_divergence_type = recorded.type;
+        }
+        result->divergence_count++;
+    }
+    result->elapsed_ms = juce::Time::getMillisecondCounterHiRes() - start;
+}
+
+static Replay_Result replay_run(const Recording &recording)
+{
+    Replay_Result result = {
+        .is_read = false,
+        .event_count = recording.events.size(),
+        .first_divergence = -1,
+        .first_divergence_type = 0,
+        .divergence_count = 0,
+        .elapsed_ms = 0.0
+    };
+    switch (recording.header.game)
+    {
+        case Recording_Game_Frequency :
+        {
+            auto context = frequency_game_context_from_recording(recording.setup);
+            if (!context)
+                return result;
+            FrequencyGame_State state = frequency_game_state_init(0);
+            state.random = recording.header.random;
+            replay_events(recording, &result, [&] (Event event) {
+                Frequency_Game_Effects effects = frequency_game_update(context.get(), state, std::move(event));
+                state = effects.new_state;
+                return frequency_game_effects_digest(effects);
+            });
+        } break;
+        case Recording_Game_Compressor :
+        {
+            auto context = compressor_game_context_from_recording(recording.setup);
+            if (!context)
+                return result;
+            CompressorGame_State state = compressor_game_state_init(0);
+            state.random = recording.header.random;
+            replay_events(recording, &result, [&] (Event event) {
+                Compressor_Game_Effects effects = compressor_game_update(context.get(), state, std::move(event));
+                state = effects.new_state;
+                return compressor_game_effects_digest(effects);
+            });
+        } break;
+        case Recording_Game_Mixer :
+        {
+            MixerGame_State state;
+            if (!mixer_game_state_from_recording(recording.setup, &state))
+                return result;
+            state.random = recording.header.random;
+            replay_events(recording, &result, [&] (Event event) {
+                Game_Mixer_Effects effects = mixer_game_update(state, std::move(event));
+                state = effects.new_state;
+                return mixer_game_effects_digest(effects);
+            });
+        } break;
+        case Recording_Game_None :
+        default :
+        {
+            return result;
+        }
+    }
+    result.is_read = true;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juce_initialiser;
+
+    if (argc < 2)
+    {
+        printf("usage : MixTrainer_Replay <recording files...>\n");
+        return 1;
+    }
+
+    bool is_identical = true;
+    printf("%-48s %-10s %10s %12s %12s %22s\n", "recording", "game", "events", "replay ms", "ns/event", "first divergence");
+    for (int i = 1; i < argc; i++)
+    {
+        juce::File file = juce::File::getCurrentWorkingDirectory().getChildFile(argv[i]);
+        Recording recording;
+        if (!recording_read(file, &recording))
+        {
+            printf("%-48s couldn't be read\n", file.getFileName().toRawUTF8());
+            is_identical = false;
+            continue;
+        }
+        Replay_Result result = replay_run(recording);
+        if (!result.is_read)
+        {
+            printf("%-48s couldn't rebuild the game\n", file.getFileName().toRawUTF8());
+            is_identical = false;
+            continue;
+        }
+
+        char divergence[64] = "none";
+        if (result.first_divergence != -1)
+        {
+            snprintf(divergence, sizeof(divergence), "#%lld (type %u, %zu in all)",
+                     (long long)result.first_divergence, result.first_divergence_type, result.divergence_count);
+            is_identical = false;
+        }
+        double ns_per_event = result.event_count > 0 ? result.elapsed_ms * 1e6 / double(result.event_count) : 0.0;
+        printf("%-48s %-10s %10zu %12.3f %12.1f %22s\n",
+               file.getFileName().toRawUTF8(),
+               replay_game_names[recording.header.game],
+               result.event_count,
+               result.elapsed_ms,
+               ns_per_event,
+               divergence);
+        fflush(stdout);
+    }
+    return is_identical ? 0 : 1;
+}
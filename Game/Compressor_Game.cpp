@@ -20,46 +20,85 @@ CompressorGame_Config compressor_game_config_default(std::string name)
     };
 }
 
-void compressor_game_post_event(CompressorGame_IO *io, Event event)
+juce::int64 compressor_game_next_deadline(const CompressorGame_Context *context, const CompressorGame_State &state)
+{
+    if (state.step == GameStep_Question 
+        && context->config.variant == Compressor_Game_Timer
+        && state.mix == Mix_Target)
+        return state.timestamp_start + context->config.timeout_ms;
+    return -1;
+}
+
+static juce::int64 compressor_game_process_event(CompressorGame_IO *io, Event event)
 {
-    Compressor_Game_Effects effects = compressor_game_update(io->game_state, event);
+    Compressor_Game_Effects effects = compressor_game_update(io->context.get(), io->game_state, event);
     assert(effects.error == 0);
     {
         std::lock_guard lock { io->update_fn_mutex };
         io->game_state = effects.new_state;
     }
     assert(effects.error == 0);
+    if (io->recorder)
+        game_recorder_write(io->recorder.get(), event, compressor_game_effects_digest(effects));
     for (uint32_t i = 0; i < io->observers.size(); i++)
     {
         io->observers[i](&effects);
     }
 
-    if (effects.quit)
-    {
-        io->on_quit();
-    }
+    juce::int64 deadline = compressor_game_next_deadline(io->context.get(), effects.new_state);
+    if (!effects.transition && !effects.ui && !effects.results && !effects.question_result && !effects.quit)
+        return deadline;
+    auto shared_effects = std::make_shared<Compressor_Game_Effects>(std::move(effects));
+    game_thread_call_on_message_thread(io->game_thread.get(), [io, shared_effects] {
+        for (uint32_t i = 0; i < io->ui_observers.size(); i++)
+        {
+            io->ui_observers[i](shared_effects.get());
+        }
+        //on_quit usually destroys the io
+        if (shared_effects->quit)
+        {
+            auto on_quit = io->on_quit;
+            on_quit();
+        }
+    });
+    return deadline;
+}
+
+void compressor_game_post_event(CompressorGame_IO *io, Event event)
+{
+    game_thread_post(io->game_thread.get(), std::move(event));
 }
 
-CompressorGame_State compressor_game_state_init(CompressorGame_Config config, 
-                                                std::vector<Audio_File> *files)
+std::shared_ptr<const CompressorGame_Context> compressor_game_context_init(CompressorGame_Config config, 
+                                                                           std::vector<Audio_File> *files)
 {
     assert(!files->empty());
-    auto state = CompressorGame_State {
-        .files = std::move(*files),
-        .config = config,
-        .timestamp_start = -1
+    return std::make_shared<const CompressorGame_Context>(CompressorGame_Context {
+        .config = std::move(config),
+        .files = std::move(*files)
+    });
+}
+
+CompressorGame_State compressor_game_state_init(uint64_t seed)
+{
+    return CompressorGame_State {
+        .timestamp_start = -1,
+        .random = game_random_init(seed)
     };
-    return state;
 }
 
-std::unique_ptr<CompressorGame_IO> compressor_game_io_init(CompressorGame_State state)
+std::unique_ptr<CompressorGame_IO> compressor_game_io_init(std::shared_ptr<const CompressorGame_Context> context, CompressorGame_State state)
 {
     auto io = std::make_unique<CompressorGame_IO>();
+    io->context = std::move(context);
     io->game_state = state;
+    io->game_thread = game_thread_start([io = io.get()] (Event event) {
+        return compressor_game_process_event(io, std::move(event));
+    });
     return io;
 }
 
-Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event event)
+Compressor_Game_Effects compressor_game_update(const CompressorGame_Context *context, CompressorGame_State state, Event event)
 {
     GameStep in_transition = GameStep_None;
     GameStep out_transition = GameStep_None;
@@ -78,6 +117,8 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
     bool done_listening = false;
     bool check_answer = false;
 
+    state.current_timestamp = event.timestamp;
+
     switch (event.type) 
     {
         case Event_Init :
@@ -91,19 +132,19 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
             switch (event.id) 
             {
                 case 0 : {
-                    assert(state.config.threshold_active || state.step == GameStep_Begin);
+                    assert(context->config.threshold_active || state.step == GameStep_Begin);
                     state.input_threshold_pos = event.value_u;
                 } break;
                 case 1 : {
-                    assert(state.config.ratio_active || state.step == GameStep_Begin);
+                    assert(context->config.ratio_active || state.step == GameStep_Begin);
                     state.input_ratio_pos = event.value_u;
                 } break;
                 case 2 : {
-                    assert(state.config.attack_active || state.step == GameStep_Begin);
+                    assert(context->config.attack_active || state.step == GameStep_Begin);
                     state.input_attack_pos = event.value_u;
                 } break;
                 case 3 : {
-                    assert(state.config.release_active || state.step == GameStep_Begin);
+                    assert(context->config.release_active || state.step == GameStep_Begin);
                     state.input_release_pos = event.value_u;
                 } break;
             }
@@ -113,7 +154,7 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
         {
             if (state.step == GameStep_Question)
             {
-                if(state.config.variant == Compressor_Game_Timer) assert(false);
+                if(context->config.variant == Compressor_Game_Timer) assert(false);
                 if (!state.can_still_listen) assert(false);
                 if (state.mix == Mix_User)
                 {
@@ -123,7 +164,7 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
                 else if (state.mix == Mix_Target)
                 {
                     if(event.value_b) assert(false);
-                    switch (state.config.variant)
+                    switch (context->config.variant)
                     {
                         case Compressor_Game_Normal : 
                         {
@@ -165,13 +206,11 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
         } break;
         case Event_Timer_Tick :
         {
-            state.current_timestamp = event.value_i64;
-
             if (state.step == GameStep_Question 
-                && state.config.variant == Compressor_Game_Timer
+                && context->config.variant == Compressor_Game_Timer
                 && state.mix == Mix_Target)
             {
-                if (state.current_timestamp >= state.timestamp_start + state.config.timeout_ms)
+                if (state.current_timestamp >= state.timestamp_start + context->config.timeout_ms)
                 {
                     done_listening = true;
                 }
@@ -196,7 +235,7 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
         {
             if (state.step != GameStep_Result) assert(false);
             out_transition = GameStep_Result;
-            if(state.current_round == state.config.total_rounds)
+            if(state.current_round == context->config.total_rounds)
                 in_transition = GameStep_EndResults;
             else
                 in_transition = GameStep_Question;
@@ -231,19 +270,44 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
 
         int points_awarded = 0;
 
-        if (state.config.threshold_active && state.target_threshold_pos == state.input_threshold_pos)
+        if (context->config.threshold_active && state.target_threshold_pos == state.input_threshold_pos)
             points_awarded++;
 
-        if (state.config.ratio_active && state.target_ratio_pos == state.input_ratio_pos) 
+        if (context->config.ratio_active && state.target_ratio_pos == state.input_ratio_pos) 
             points_awarded++;
 
-        if (state.config.attack_active && state.target_attack_pos == state.input_attack_pos) 
+        if (context->config.attack_active && state.target_attack_pos == state.input_attack_pos) 
             points_awarded++;
 
-        if (state.config.release_active && state.target_release_pos == state.input_release_pos) 
+        if (context->config.release_active && state.target_release_pos == state.input_release_pos) 
             points_awarded++;
 
         state.score += points_awarded;
+
+        auto step_distance = [] (uint32_t a, uint32_t b) { return a > b ? a - b : b - a; };
+        uint32_t distance = step_distance(state.target_threshold_pos, state.input_threshold_pos)
+            + step_distance(state.target_ratio_pos, state.input_ratio_pos)
+            + step_distance(state.target_attack_pos, state.input_attack_pos)
+            + step_distance(state.target_release_pos, state.input_release_pos);
+        int64_t response_time_ms = state.current_timestamp - state.question_timestamp;
+        state.question_count++;
+        state.total_distance += distance;
+        state.total_response_time_ms += response_time_ms;
+        effects.question_result = Compressor_Question_Result {
+            .timestamp = state.current_timestamp,
+            .file_hash = context->files[static_cast<size_t>(state.current_file_idx)].hash,
+            .response_time_ms = response_time_ms,
+            .target_threshold_db = context->config.threshold_values_db[state.target_threshold_pos],
+            .target_ratio = context->config.ratio_values[state.target_ratio_pos],
+            .target_attack = context->config.attack_values[state.target_attack_pos],
+            .target_release = context->config.release_values[state.target_release_pos],
+            .answer_threshold_db = context->config.threshold_values_db[state.input_threshold_pos],
+            .answer_ratio = context->config.ratio_values[state.input_ratio_pos],
+            .answer_attack = context->config.attack_values[state.input_attack_pos],
+            .answer_release = context->config.release_values[state.input_release_pos],
+            .distance = distance,
+            .points = points_awarded
+        };
         out_transition = GameStep_Question;
         in_transition = GameStep_Result;
     }
@@ -300,12 +364,15 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
             state.score = 0;
             state.mix = Mix_Hidden;
             
-            state.input_threshold_pos = checked_cast<uint32_t>(state.config.threshold_values_db.size()) - 1;
+            state.input_threshold_pos = checked_cast<uint32_t>(context->config.threshold_values_db.size()) - 1;
             state.input_ratio_pos = 0;
             state.input_attack_pos = 0;
             state.input_release_pos = 0;
 
             state.current_round = 0;
+            state.question_count = 0;
+            state.total_distance = 0;
+            state.total_response_time_ms = 0;
             update_audio = true;
             update_ui = true;
         }break;
@@ -315,43 +382,44 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
             state.can_still_listen = true;
             state.current_round++;
 
-            state.target_threshold_pos = random_uint(checked_cast<uint32_t>(state.config.threshold_values_db.size()));
-            state.target_ratio_pos = random_uint(checked_cast<uint32_t>(state.config.ratio_values.size()));
-            state.target_attack_pos = random_uint(checked_cast<uint32_t>(state.config.attack_values.size()));
-            state.target_release_pos = random_uint(checked_cast<uint32_t>(state.config.release_values.size()));
+            state.target_threshold_pos = game_random_uint(&state.random, checked_cast<uint32_t>(context->config.threshold_values_db.size()));
+            state.target_ratio_pos = game_random_uint(&state.random, checked_cast<uint32_t>(context->config.ratio_values.size()));
+            state.target_attack_pos = game_random_uint(&state.random, checked_cast<uint32_t>(context->config.attack_values.size()));
+            state.target_release_pos = game_random_uint(&state.random, checked_cast<uint32_t>(context->config.release_values.size()));
 
             {
                 //TODO
-                if (state.config.threshold_active)
-                    state.input_threshold_pos = checked_cast<uint32_t>(state.config.threshold_values_db.size()) - 1;
+                if (context->config.threshold_active)
+                    state.input_threshold_pos = checked_cast<uint32_t>(context->config.threshold_values_db.size()) - 1;
                 else
                     state.input_threshold_pos = state.target_threshold_pos;
 
-                if (state.config.ratio_active)
+                if (context->config.ratio_active)
                     state.input_ratio_pos = 0;
                 else
                     state.input_ratio_pos = state.target_ratio_pos;
 
-                if (state.config.attack_active)
+                if (context->config.attack_active)
                     state.input_attack_pos = 0;
                 else
                     state.input_attack_pos = state.target_attack_pos;
 
-                if (state.config.release_active)
+                if (context->config.release_active)
                     state.input_release_pos = 0;
                 else
                     state.input_release_pos = state.target_release_pos;
             }
 
-            state.current_file_idx = random_uint(checked_cast<uint32_t>(state.files.size()));
+            state.current_file_idx = game_random_uint(&state.random, checked_cast<uint32_t>(context->files.size()));
+            state.question_timestamp = state.current_timestamp;
             effects.player = Effect_Player {
                 .commands = { 
-                    { .type = Audio_Command_Load, .value_file = state.files[static_cast<size_t>(state.current_file_idx)] },
+                    { .type = Audio_Command_Load, .value_file = context->files[static_cast<size_t>(state.current_file_idx)] },
                     { .type = Audio_Command_Play },
                 }
             };
             
-            switch (state.config.variant)
+            switch (context->config.variant)
             {
                 case Compressor_Game_Normal : {
                 } break;
@@ -359,7 +427,7 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
                     state.timestamp_start = state.current_timestamp;
                 } break;
                 case Compressor_Game_Tries : {
-                    state.remaining_listens = state.config.listens;
+                    state.remaining_listens = context->config.listens;
                 } break;
             }
 
@@ -381,9 +449,13 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
                     { .type = Audio_Command_Stop },
                 }
             };
+            int question_count = std::max(state.question_count, 1);
             state.results = {
                 .score = state.score,
-                .analytics = juce::Random::getSystemRandom().nextFloat()
+                .question_count = state.question_count,
+                .mean_distance = float(state.total_distance) / float(question_count),
+                .mean_response_time_ms = float(state.total_response_time_ms) / float(question_count),
+                .timestamp = state.current_timestamp
             };
             effects.results = state.results;
             update_audio = true;
@@ -424,10 +496,10 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
             {
                 dsp.comp = {
                     .is_on = true,
-                    .threshold_gain = state.config.threshold_values_db[threshold_pos],
-                    .ratio = state.config.ratio_values[ratio_pos],
-                    .attack = state.config.attack_values[attack_pos],
-                    .release = state.config.release_values[release_pos],
+                    .threshold_gain = context->config.threshold_values_db[threshold_pos],
+                    .ratio = context->config.ratio_values[ratio_pos],
+                    .attack = context->config.attack_values[attack_pos],
+                    .release = context->config.release_values[release_pos],
                     .makeup_gain = 1.0f,
                 };
             } break;
@@ -439,7 +511,7 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
                 jassertfalse;
             } break;
         }
-        effects.dsp = Effect_DSP_Single_Track { dsp };
+        effects.dsp = Effect_DSP_Single_Track { .dsp_state = dsp, .eq_gain_ramp = {} };
     }
 
     if (update_ui)
@@ -456,10 +528,10 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
                 .attack_pos = attack_pos,
                 .release_pos = release_pos,
 
-                .threshold_values_db = state.config.threshold_values_db,
-                .ratio_values = state.config.ratio_values,
-                .attack_values = state.config.attack_values,
-                .release_values = state.config.release_values
+                .threshold_values_db = context->config.threshold_values_db,
+                .ratio_values = context->config.ratio_values,
+                .attack_values = context->config.attack_values,
+                .release_values = context->config.release_values
             }
         };
         if (state.step != GameStep_EndResults)
@@ -467,28 +539,28 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
             Widget_Interaction_Type active_visibility = gameStepToFaderStep(state.step, state.mix);
             Widget_Interaction_Type inactive_visibility = state.step == GameStep_Begin ? Widget_Editing : Widget_Showing;
 
-            if (state.config.threshold_active)
+            if (context->config.threshold_active)
                 effects.ui->comp_widget.threshold_visibility = active_visibility;
             else
                 effects.ui->comp_widget.threshold_visibility = inactive_visibility;
 
-            if (state.config.ratio_active)
+            if (context->config.ratio_active)
                 effects.ui->comp_widget.ratio_visibility = active_visibility;
             else
                 effects.ui->comp_widget.ratio_visibility = inactive_visibility;
 
-            if (state.config.attack_active)
+            if (context->config.attack_active)
                 effects.ui->comp_widget.attack_visibility = active_visibility;
             else
                 effects.ui->comp_widget.attack_visibility = inactive_visibility;
 
-            if (state.config.release_active)
+            if (context->config.release_active)
                 effects.ui->comp_widget.release_visibility = active_visibility;
             else
                 effects.ui->comp_widget.release_visibility = inactive_visibility;
         }
         
-        switch (state.config.variant)
+        switch (context->config.variant)
         {
             case Compressor_Game_Normal : {
                 effects.ui->mix_toggles = state.mix;
@@ -515,9 +587,9 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
             case GameStep_Question :
             {
                 effects.ui->header_center_text = "Listen and reproduce";
-                effects.ui->header_right_text = "Round " + std::to_string(state.current_round) + " / " + std::to_string(state.config.total_rounds);
+                effects.ui->header_right_text = "Round " + std::to_string(state.current_round) + " / " + std::to_string(context->config.total_rounds);
                 
-                switch (state.config.variant)
+                switch (context->config.variant)
                 {
                     case Compressor_Game_Normal :
                     {
@@ -558,7 +630,7 @@ Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event
             case GameStep_Result :
             {
                 effects.ui->header_center_text = "Score : " + std::to_string(state.score);
-                effects.ui->header_right_text = "Round " + std::to_string(state.current_round) + " / " + std::to_string(state.config.total_rounds);
+                effects.ui->header_right_text = "Round " + std::to_string(state.current_round) + " / " + std::to_string(context->config.total_rounds);
                 effects.ui->bottom_button_text = "Next";
                 effects.ui->bottom_button_event = Event_Click_Next;
             } break;
@@ -586,6 +658,128 @@ void compressor_game_add_observer(CompressorGame_IO *io, compressor_game_observe
     io->observers.push_back(std::move(observer));
 }
 
+void compressor_game_add_ui_observer(CompressorGame_IO *io, compressor_game_observer_t observer)
+{
+    io->ui_observers.push_back(std::move(observer));
+}
+
+static const juce::Identifier id_recording_root = "compressor_recording";
+static const juce::Identifier id_recording_config = "config";
+static const juce::Identifier id_recording_files = "files";
+
+std::string compressor_game_recording_setup(const CompressorGame_Context *context)
+{
+    std::vector<CompressorGame_Config> configs = { context->config };
+    juce::ValueTree root_node = { id_recording_root, {
+        { id_recording_config, juce::String(compressor_game_serialize(&configs)) },
+        { id_recording_files, juce::String(recording_files_serialize(context->files)) },
+    } };
+    return root_node.toXmlString().toStdString();
+}
+
+std::shared_ptr<const CompressorGame_Context> compressor_game_context_from_recording(const std::string &setup)
+{
+    juce::ValueTree root_node = juce::ValueTree::fromXml(setup);
+    if (root_node.getType() != id_recording_root)
+        return nullptr;
+    auto configs = compressor_game_deserialize(root_node.getProperty(id_recording_config, "").toString().toStdString());
+    auto files = recording_files_deserialize(root_node.getProperty(id_recording_files, "").toString().toStdString());
+    if (configs.size() != 1 || files.empty())
+        return nullptr;
+    return compressor_game_context_init(std::move(configs[0]), &files);
+}
+
+void compressor_game_record(CompressorGame_IO *io)
+{
+    io->recorder = game_recorder_open(Recording_Game_Compressor, io->game_state.random, compressor_game_recording_setup(io->context.get()));
+}
+
+static void digest_results(uint64_t *digest, const CompressorGame_Results &results)
+{
+    digest_value(digest, results.score);
+    digest_value(digest, results.question_count);
+    digest_value(digest, results.mean_distance);
+    digest_value(digest, results.mean_response_time_ms);
+    digest_value(digest, results.timestamp);
+}
+
+uint64_t compressor_game_effects_digest(const Compressor_Game_Effects &effects)
+{
+    uint64_t digest = digest_init;
+    digest_value(&digest, effects.error);
+    digest_value(&digest, effects.quit);
+    if (effects.transition)
+    {
+        digest_value(&digest, effects.transition->in_transition);
+        digest_value(&digest, effects.transition->out_transition);
+    }
+    if (effects.dsp)
+        digest_dsp(&digest, effects.dsp->dsp_state);
+    if (effects.player)
+        digest_player(&digest, *effects.player);
+    if (effects.ui)
+    {
+        const auto &ui = *effects.ui;
+        digest_value(&digest, ui.transition.in_transition);
+        digest_value(&digest, ui.transition.out_transition);
+        digest_results(&digest, ui.results);
+        digest_string(&digest, ui.header_center_text);
+        digest_string(&digest, ui.header_right_text);
+        digest_value(&digest, ui.comp_widget.threshold_visibility);
+        digest_value(&digest, ui.comp_widget.ratio_visibility);
+        digest_value(&digest, ui.comp_widget.attack_visibility);
+        digest_value(&digest, ui.comp_widget.release_visibility);
+        digest_value(&digest, ui.comp_widget.threshold_pos);
+        digest_value(&digest, ui.comp_widget.ratio_pos);
+        digest_value(&digest, ui.comp_widget.attack_pos);
+        digest_value(&digest, ui.comp_widget.release_pos);
+        digest_value(&digest, ui.mix_toggles);
+        digest_string(&digest, ui.bottom_button_text);
+        digest_value(&digest, ui.bottom_button_event);
+    }
+    if (effects.results)
+        digest_results(&digest, *effects.results);
+    if (effects.question_result)
+    {
+        const auto &result = *effects.question_result;
+        digest_value(&digest, result.timestamp);
+        digest_value(&digest, result.file_hash);
+        digest_value(&digest, result.response_time_ms);
+        digest_value(&digest, result.target_threshold_db);
+        digest_value(&digest, result.target_ratio);
+        digest_value(&digest, result.target_attack);
+        digest_value(&digest, result.target_release);
+        digest_value(&digest, result.answer_threshold_db);
+        digest_value(&digest, result.answer_ratio);
+        digest_value(&digest, result.answer_attack);
+        digest_value(&digest, result.answer_release);
+        digest_value(&digest, result.distance);
+        digest_value(&digest, result.points);
+    }
+    const auto &state = effects.new_state;
+    digest_value(&digest, state.step);
+    digest_value(&digest, state.mix);
+    digest_value(&digest, state.score);
+    digest_value(&digest, state.target_threshold_pos);
+    digest_value(&digest, state.target_ratio_pos);
+    digest_value(&digest, state.target_attack_pos);
+    digest_value(&digest, state.target_release_pos);
+    digest_value(&digest, state.input_threshold_pos);
+    digest_value(&digest, state.input_ratio_pos);
+    digest_value(&digest, state.input_attack_pos);
+    digest_value(&digest, state.input_release_pos);
+    digest_value(&digest, state.current_file_idx);
+    digest_value(&digest, state.remaining_listens);
+    digest_value(&digest, state.can_still_listen);
+    digest_value(&digest, state.timestamp_start);
+    digest_value(&digest, state.question_timestamp);
+    digest_value(&digest, state.current_round);
+    digest_value(&digest, state.question_count);
+    digest_value(&digest, state.total_distance);
+    digest_value(&digest, state.total_response_time_ms);
+    return digest;
+}
+
 static const juce::Identifier id_config_root = "configs";
 static const juce::Identifier id_config = "config";
 static const juce::Identifier id_config_title = "title";
@@ -3,10 +3,32 @@
 struct CompressorGame_Results
 {
     int score;
-    float analytics;
-    //temps moyen ? distance moyenne ? stats ?
+    int question_count;
+    float mean_distance;
+    float mean_response_time_ms;
+    int64_t timestamp;
 };
 
+//one per answered question, inactive parameters have their answer equal to their target
+struct Compressor_Question_Result
+{
+    int64_t timestamp;
+    int64_t file_hash;
+    int64_t response_time_ms;
+    float target_threshold_db;
+    float target_ratio;
+    float target_attack;
+    float target_release;
+    float answer_threshold_db;
+    float answer_ratio;
+    float answer_attack;
+    float answer_release;
+    //in steps, summed over the active parameters
+    uint32_t distance;
+    int32_t points;
+};
+static_assert(std::is_trivially_copyable_v<Compressor_Question_Result>);
+
 struct Compressor_Game_Effect_UI {
     Effect_Transition transition;
     CompressorGame_Results results;
@@ -104,16 +126,30 @@ struct CompressorGame_State
     uint32_t input_release_pos;
 
     //
+    //into CompressorGame_Context::files
     uint32_t current_file_idx;
-    std::vector<Audio_File> files;
-    CompressorGame_Config config;
     CompressorGame_Results results;
     
     int remaining_listens;
     bool can_still_listen;
     int64_t timestamp_start;
+    int64_t question_timestamp;
     int64_t current_timestamp;
     int current_round;
+
+    int question_count;
+    uint32_t total_distance;
+    int64_t total_response_time_ms;
+    Game_Random random;
+};
+//copied on every event, under the io mutex, it must not own any memory
+static_assert(std::is_trivially_copyable_v<CompressorGame_State>);
+
+//what doesn't change during a game, built when the game starts and shared, never copied, by every update
+struct CompressorGame_Context
+{
+    CompressorGame_Config config;
+    std::vector<Audio_File> files;
 };
 
 struct Compressor_Game_Effects {
@@ -124,6 +160,7 @@ struct Compressor_Game_Effects {
     std::optional < Effect_Player > player;
     std::optional < Compressor_Game_Effect_UI > ui;
     std::optional < CompressorGame_Results > results;
+    std::optional < Compressor_Question_Result > question_result;
     bool quit;
 };
 
@@ -131,11 +168,19 @@ using compressor_game_observer_t = std::function<void(Compressor_Game_Effects*)>
 
 struct CompressorGame_IO
 {
-    Timer timer;
     std::mutex update_fn_mutex;
+    //called on the game thread, for the audio
     std::vector<compressor_game_observer_t> observers;
+    //called on the message thread
+    std::vector<compressor_game_observer_t> ui_observers;
+    //message thread
     std::function < void() > on_quit;
+    std::shared_ptr<const CompressorGame_Context> context;
     CompressorGame_State game_state;
+    //game thread, nullptr when recording is off
+    std::unique_ptr<Game_Recorder> recorder;
+    //last, stopped before the rest of the io goes away
+    std::unique_ptr<Game_Thread> game_thread;
 };
 
 
@@ -143,9 +188,22 @@ std::string compressor_game_serialize(std::vector<CompressorGame_Config> *compre
 std::vector<CompressorGame_Config> compressor_game_deserialize(std::string xml_string);
 
 CompressorGame_Config compressor_game_config_default(std::string name);
-CompressorGame_State compressor_game_state_init(CompressorGame_Config config, std::vector<Audio_File> *files);
-std::unique_ptr<CompressorGame_IO> compressor_game_io_init(CompressorGame_State state);
+std::shared_ptr<const CompressorGame_Context> compressor_game_context_init(CompressorGame_Config config, std::vector<Audio_File> *files);
+CompressorGame_State compressor_game_state_init(uint64_t seed);
+std::unique_ptr<CompressorGame_IO> compressor_game_io_init(std::shared_ptr<const CompressorGame_Context> context, CompressorGame_State state);
+//before the first event is posted
 void compressor_game_add_observer(CompressorGame_IO *io, compressor_game_observer_t observer);
+void compressor_game_add_ui_observer(CompressorGame_IO *io, compressor_game_observer_t observer);
+//before the first event is posted, does nothing unless MIXTRAINER_RECORDINGS is set
+void compressor_game_record(CompressorGame_IO *io);
 
+//any thread, the update runs on the game thread
 void compressor_game_post_event(CompressorGame_IO *io, Event event);
-Compressor_Game_Effects compressor_game_update(CompressorGame_State state, Event event);
\ No newline at end of file
+Compressor_Game_Effects compressor_game_update(const CompressorGame_Context *context, CompressorGame_State state, Event event);
+//when the state next needs an Event_Timer_Tick, -1 when it only waits for the user
+juce::int64 compressor_game_next_deadline(const CompressorGame_Context *context, const CompressorGame_State &state);
+
+std::string compressor_game_recording_setup(const CompressorGame_Context *context);
+//nullptr when the setup can't be read
+std::shared_ptr<const CompressorGame_Context> compressor_game_context_from_recording(const std::string &setup);
+uint64_t compressor_game_effects_digest(const Compressor_Game_Effects &effects);
@@ -28,45 +28,84 @@ FrequencyGame_Config frequency_game_config_default(std::string name)
     };
 }
 
-void frequency_game_post_event(FrequencyGame_IO *io, Event event)
+juce::int64 frequency_game_next_deadline(const FrequencyGame_Context *context, const FrequencyGame_State &state)
+{
+    const FrequencyGame_Config &config = context->config;
+    if (state.step == GameStep_Question && state.is_prelistening && config.prelisten_type == PreListen_Timeout)
+        return state.timestamp_start + config.prelisten_timeout_ms;
+    if (state.step == GameStep_Question && !state.is_prelistening && config.question_type != Frequency_Question_Free)
+        return state.timestamp_start + config.question_timeout_ms;
+    if (state.step == GameStep_Result && config.result_timeout_enabled)
+        return state.timestamp_start + config.result_timeout_ms;
+    return -1;
+}
+
+static juce::int64 frequency_game_process_event(FrequencyGame_IO *io, Event event)
 {
-    Frequency_Game_Effects effects = frequency_game_update(io->game_state, event);
+    Frequency_Game_Effects effects = frequency_game_update(io->context.get(), io->game_state, event);
     assert(effects.error == 0);
     {
         std::lock_guard lock { io->update_fn_mutex };
         io->game_state = effects.new_state;
     }
     assert(effects.error == 0);
+    if (io->recorder)
+        game_recorder_write(io->recorder.get(), event, frequency_game_effects_digest(effects));
     for(auto &observer : io->observers)
         observer(&effects);
 
-    if (effects.quit)
-    {
-        io->on_quit();
-    }
+    juce::int64 deadline = frequency_game_next_deadline(io->context.get(), effects.new_state);
+    if (!effects.transition && !effects.ui && !effects.results && !effects.question_result && !effects.quit)
+        return deadline;
+    auto shared_effects = std::make_shared<Frequency_Game_Effects>(std::move(effects));
+    game_thread_call_on_message_thread(io->game_thread.get(), [io, shared_effects] {
+        for(auto &observer : io->ui_observers)
+            observer(shared_effects.get());
+        //on_quit usually destroys the io
+        if (shared_effects->quit)
+        {
+            auto on_quit = io->on_quit;
+            on_quit();
+        }
+    });
+    return deadline;
+}
+
+void frequency_game_post_event(FrequencyGame_IO *io, Event event)
+{
+    game_thread_post(io->game_thread.get(), std::move(event));
 }
 
-FrequencyGame_State frequency_game_state_init(FrequencyGame_Config config, 
-                                              std::vector<Audio_File> *files)
+std::shared_ptr<const FrequencyGame_Context> frequency_game_context_init(FrequencyGame_Config config, 
+                                                                         std::vector<Audio_File> *files)
 {
     assert(!files->empty());
-    auto state = FrequencyGame_State {
-        .files = std::move(*files),
-        .config = config,
-        .timestamp_start = -1
-    };
+    return std::make_shared<const FrequencyGame_Context>(FrequencyGame_Context {
+        .config = std::move(config),
+        .files = std::move(*files)
+    });
+}
 
-    return state;
+FrequencyGame_State frequency_game_state_init(uint64_t seed)
+{
+    return FrequencyGame_State {
+        .timestamp_start = -1,
+        .random = game_random_init(seed)
+    };
 }
 
-std::unique_ptr<FrequencyGame_IO> frequency_game_io_init(FrequencyGame_State state)
+std::unique_ptr<FrequencyGame_IO> frequency_game_io_init(std::shared_ptr<const FrequencyGame_Context> context, FrequencyGame_State state)
 {
     auto io = std::make_unique<FrequencyGame_IO>();
+    io->context = std::move(context);
     io->game_state = state;
+    io->game_thread = game_thread_start([io = io.get()] (Event event) {
+        return frequency_game_process_event(io, std::move(event));
+    });
     return io;
 }
 
-Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event event)
+Frequency_Game_Effects frequency_game_update(const FrequencyGame_Context *context, FrequencyGame_State state, Event event)
 {
     GameStep in_transition = GameStep_None;
     GameStep out_transition = GameStep_None;
@@ -86,6 +125,8 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
     uint32_t TEMP_answer_frequency = 0;
     bool done_prelistening = false;
 
+    state.current_timestamp = event.timestamp;
+
     switch (event.type)
     {
         case Event_Init :
@@ -123,30 +164,39 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
         } break;
         case Event_Timer_Tick :
         {
-            state.current_timestamp = event.value_i64;
-            if (state.step == GameStep_Question && state.is_prelistening == true && state.config.prelisten_type == PreListen_Timeout)
+            if (state.step == GameStep_Question && state.is_prelistening == true && context->config.prelisten_type == PreListen_Timeout)
             {
                 if (state.current_timestamp >=
-                    state.timestamp_start + state.config.prelisten_timeout_ms)
+                    state.timestamp_start + context->config.prelisten_timeout_ms)
                 {
                     done_prelistening = true;
                 }
             }
-            if (state.step == GameStep_Question && state.is_prelistening == false && state.config.question_type != Frequency_Question_Free)
+            if (state.step == GameStep_Question && state.is_prelistening == false && context->config.question_type != Frequency_Question_Free)
             {
                 if (state.current_timestamp >=
-                    state.timestamp_start + state.config.question_timeout_ms)
+                    state.timestamp_start + context->config.question_timeout_ms)
                 {
                     state.lives--;
-            
+                    state.question_count++;
+                    effects.question_result = Frequency_Question_Result {
+                        .timestamp = state.current_timestamp,
+                        .file_hash = context->files[static_cast<size_t>(state.current_file_idx)].hash,
+                        .response_time_ms = state.current_timestamp - state.question_timestamp,
+                        .target_frequency = state.target_frequency,
+                        .answer_frequency = 0,
+                        .distance = 1.0f,
+                        .points = 0
+                    };
+
                     out_transition = GameStep_Question;
                     in_transition = GameStep_Result;
                 }
             }
-            else if (state.step == GameStep_Result && state.config.result_timeout_enabled)
+            else if (state.step == GameStep_Result && context->config.result_timeout_enabled)
             {
                 if (state.current_timestamp >=
-                    state.timestamp_start + state.config.result_timeout_ms)
+                    state.timestamp_start + context->config.result_timeout_ms)
                 {
                     
                     out_transition = GameStep_Result;
@@ -156,8 +206,6 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
                         in_transition = GameStep_EndResults;
                 }
             }
-            if (state.step == GameStep_Question && state.config.question_type == Frequency_Question_Rising)
-                update_audio = true;
         } break;
         case Event_Click_Begin :
         {
@@ -202,12 +250,13 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
     if (check_answer)
     {
         if (state.step != GameStep_Question) return { .error = 1 };
-        float clicked_ratio = normalize_frequency(TEMP_answer_frequency, state.config.min_f, state.config.num_octaves);
-        float target_ratio = normalize_frequency(state.target_frequency, state.config.min_f, state.config.num_octaves);
+        float clicked_ratio = normalize_frequency(TEMP_answer_frequency, context->config.min_f, context->config.num_octaves);
+        float target_ratio = normalize_frequency(state.target_frequency, context->config.min_f, context->config.num_octaves);
         float distance = std::abs(clicked_ratio - target_ratio);
+        int points_scored = 0;
         if (distance < state.correct_answer_window)
         {
-            int points_scored = int((1.0f - distance) * 100.0f);
+            points_scored = int((1.0f - distance) * 100.0f);
             state.score += points_scored;
             state.correct_answer_window *= 0.95f;
         }
@@ -215,6 +264,21 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
         {
             state.lives--;
         }
+
+        int64_t response_time_ms = state.current_timestamp - state.question_timestamp;
+        state.question_count++;
+        state.answered_count++;
+        state.total_distance += distance;
+        state.total_response_time_ms += response_time_ms;
+        effects.question_result = Frequency_Question_Result {
+            .timestamp = state.current_timestamp,
+            .file_hash = context->files[static_cast<size_t>(state.current_file_idx)].hash,
+            .response_time_ms = response_time_ms,
+            .target_frequency = state.target_frequency,
+            .answer_frequency = TEMP_answer_frequency,
+            .distance = distance,
+            .points = points_scored
+        };
             
         in_transition = GameStep_Result;
         out_transition = GameStep_Question;
@@ -224,6 +288,7 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
     {
         assert(state.is_prelistening == true);
         state.is_prelistening = false;
+        state.question_timestamp = state.current_timestamp;
         update_audio = true;
         update_ui = true;
     }
@@ -268,18 +333,22 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
             state.step = GameStep_Begin;
             state.score = 0;
             state.lives = 5;
+            state.question_count = 0;
+            state.answered_count = 0;
+            state.total_distance = 0.0;
+            state.total_response_time_ms = 0;
 
-            state.correct_answer_window = state.config.initial_correct_answer_window;
+            state.correct_answer_window = context->config.initial_correct_answer_window;
 
             update_audio = true;
             update_ui = true;
         }break;
         case GameStep_Question : {
             state.step = GameStep_Question;
-            state.target_frequency = denormalize_frequency(juce::Random::getSystemRandom().nextFloat(), state.config.min_f, state.config.num_octaves);
+            state.target_frequency = denormalize_frequency(game_random_float(&state.random), context->config.min_f, context->config.num_octaves);
     
-            state.current_file_idx = random_uint(checked_cast<uint32_t>(state.files.size()));
-            auto & file = state.files[static_cast<size_t>(state.current_file_idx)];
+            state.current_file_idx = game_random_uint(&state.random, checked_cast<uint32_t>(context->files.size()));
+            auto & file = context->files[static_cast<size_t>(state.current_file_idx)];
             effects.player = Effect_Player {
                 .commands = { 
                     { .type = Audio_Command_Load, .value_file = file},
@@ -287,11 +356,12 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
                 }
             };
             
-            if(state.config.prelisten_type == PreListen_Timeout)
+            if(context->config.prelisten_type == PreListen_Timeout)
                 state.is_prelistening = true;
             else 
                 state.is_prelistening = false;
             state.timestamp_start = state.current_timestamp;
+            state.question_timestamp = state.current_timestamp;
             update_audio = true;
             update_ui = true;
         }break;
@@ -310,9 +380,13 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
                     { .type = Audio_Command_Stop },
                 }
             };
+            int answered_count = std::max(state.answered_count, 1);
             state.results = {
                 .score = state.score,
-                .analytics = juce::Random::getSystemRandom().nextFloat()
+                .question_count = state.question_count,
+                .mean_distance = float(state.total_distance / answered_count),
+                .mean_response_time_ms = float(state.total_response_time_ms) / float(answered_count),
+                .timestamp = state.current_timestamp
             };
             effects.results = state.results;
             update_audio = true;
@@ -323,9 +397,10 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
     if (update_audio)
     {
         Channel_DSP_State dsp = ChannelDSP_on();
+        DSP_EQ_Gain_Ramp eq_gain_ramp = {};
 
-        float compensation_gain_db = state.config.eq_gain_db > 0.0f ? 
-            - state.config.eq_gain_db :
+        float compensation_gain_db = context->config.eq_gain_db > 0.0f ? 
+            - context->config.eq_gain_db :
             0.0f;
         dsp.gain_db = compensation_gain_db;
 
@@ -342,19 +417,23 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
                 }
                 else
                 {
-                    float ratio = 1.0f;
-                    if (state.config.question_type == Frequency_Question_Rising)
+                    dsp.eq_bands[0] = eq_band_peak((float)state.target_frequency, context->config.eq_quality, juce::Decibels::decibelsToGain(context->config.eq_gain_db));
+                    //from where the question is now up to the full gain at the timeout, in one push
+                    if (context->config.question_type == Frequency_Question_Rising)
                     {
-                        ratio = float(state.current_timestamp - state.timestamp_start) / float(state.config.question_timeout_ms);
-                        assert(ratio >= 0.0f && ratio < 1.0f);
-                        DBG("ratio " << ratio);
+                        int64_t elapsed_ms = state.current_timestamp - state.timestamp_start;
+                        float ratio = std::clamp(float(elapsed_ms) / float(context->config.question_timeout_ms), 0.0f, 1.0f);
+                        eq_gain_ramp = {
+                            .start_gain_db = context->config.eq_gain_db * ratio,
+                            .end_gain_db = context->config.eq_gain_db,
+                            .duration_ms = std::max(0, context->config.question_timeout_ms - static_cast<int>(elapsed_ms))
+                        };
                     }
-                    dsp.eq_bands[0] = eq_band_peak((float)state.target_frequency, state.config.eq_quality, juce::Decibels::decibelsToGain(state.config.eq_gain_db * ratio));
                 }
             } break;
             case GameStep_Result :
             {
-                dsp.eq_bands[0] = eq_band_peak((float)state.target_frequency, state.config.eq_quality, juce::Decibels::decibelsToGain(state.config.eq_gain_db));
+                dsp.eq_bands[0] = eq_band_peak((float)state.target_frequency, context->config.eq_quality, juce::Decibels::decibelsToGain(context->config.eq_gain_db));
             } break;
             case GameStep_EndResults :
             {
@@ -364,7 +443,7 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
                 jassertfalse;
             } break;
         }
-        effects.dsp = Effect_DSP_Single_Track { dsp };
+        effects.dsp = Effect_DSP_Single_Track { .dsp_state = dsp, .eq_gain_ramp = eq_gain_ramp };
 
     }
 
@@ -376,8 +455,8 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
             .out_transition = out_transition
         };
 
-        effects.ui->freq_widget.min_f = state.config.min_f;
-        effects.ui->freq_widget.num_octaves = state.config.num_octaves;
+        effects.ui->freq_widget.min_f = context->config.min_f;
+        effects.ui->freq_widget.num_octaves = context->config.num_octaves;
         switch (state.step)
         {
             case GameStep_Begin :
@@ -390,7 +469,7 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
             case GameStep_Question :
             {
                 effects.ui->header_right_text = "Score : " + std::to_string(state.score);
-                effects.ui->ui_target = state.config.input == Frequency_Input_Widget ? 0 : 2;
+                effects.ui->ui_target = context->config.input == Frequency_Input_Widget ? 0 : 2;
 
                 effects.ui->freq_widget.display_target = false;
                 if (state.is_prelistening)
@@ -413,7 +492,7 @@ Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event ev
             {
                 effects.ui->header_right_text = "Score : " + std::to_string(state.score);
         
-                effects.ui->ui_target = state.config.input == Frequency_Input_Widget ? 0 : 2;
+                effects.ui->ui_target = context->config.input == Frequency_Input_Widget ? 0 : 2;
                 effects.ui->freq_widget.display_target = true;
                 effects.ui->freq_widget.target_frequency = state.target_frequency;
                 //TODO remove all that ! should not depend on the event, but on some kind of state 
@@ -467,6 +546,120 @@ void frequency_game_add_observer(FrequencyGame_IO *io, frequency_game_observer_t
     io->observers.push_back(std::move(observer));
 }
 
+void frequency_game_add_ui_observer(FrequencyGame_IO *io, frequency_game_observer_t observer)
+{
+    io->ui_observers.push_back(std::move(observer));
+}
+
+static const juce::Identifier id_recording_root = "frequency_recording";
+static const juce::Identifier id_recording_config = "config";
+static const juce::Identifier id_recording_files = "files";
+
+std::string frequency_game_recording_setup(const FrequencyGame_Context *context)
+{
+    std::vector<FrequencyGame_Config> configs = { context->config };
+    juce::ValueTree root_node = { id_recording_root, {
+        { id_recording_config, juce::String(frequency_game_serlialize(&configs)) },
+        { id_recording_files, juce::String(recording_files_serialize(context->files)) },
+    } };
+    return root_node.toXmlString().toStdString();
+}
+
+std::shared_ptr<const FrequencyGame_Context> frequency_game_context_from_recording(const std::string &setup)
+{
+    juce::ValueTree root_node = juce::ValueTree::fromXml(setup);
+    if (root_node.getType() != id_recording_root)
+        return nullptr;
+    auto configs = frequency_game_deserialize(root_node.getProperty(id_recording_config, "").toString().toStdString());
+    auto files = recording_files_deserialize(root_node.getProperty(id_recording_files, "").toString().toStdString());
+    if (configs.size() != 1 || files.empty())
+        return nullptr;
+    return frequency_game_context_init(std::move(configs[0]), &files);
+}
+
+void frequency_game_record(FrequencyGame_IO *io)
+{
+    io->recorder = game_recorder_open(Recording_Game_Frequency, io->game_state.random, frequency_game_recording_setup(io->context.get()));
+}
+
+static void digest_results(uint64_t *digest, const FrequencyGame_Results &results)
+{
+    digest_value(digest, results.score);
+    digest_value(digest, results.question_count);
+    digest_value(digest, results.mean_distance);
+    digest_value(digest, results.mean_response_time_ms);
+    digest_value(digest, results.timestamp);
+}
+
+uint64_t frequency_game_effects_digest(const Frequency_Game_Effects &effects)
+{
+    uint64_t digest = digest_init;
+    digest_value(&digest, effects.error);
+    digest_value(&digest, effects.quit);
+    if (effects.transition)
+    {
+        digest_value(&digest, effects.transition->in_transition);
+        digest_value(&digest, effects.transition->out_transition);
+    }
+    if (effects.dsp)
+    {
+        digest_dsp(&digest, effects.dsp->dsp_state);
+        digest_value(&digest, effects.dsp->eq_gain_ramp.start_gain_db);
+        digest_value(&digest, effects.dsp->eq_gain_ramp.end_gain_db);
+        digest_value(&digest, effects.dsp->eq_gain_ramp.duration_ms);
+    }
+    if (effects.player)
+        digest_player(&digest, *effects.player);
+    if (effects.ui)
+    {
+        const auto &ui = *effects.ui;
+        digest_value(&digest, ui.transition.in_transition);
+        digest_value(&digest, ui.transition.out_transition);
+        digest_value(&digest, ui.ui_target);
+        digest_value(&digest, ui.freq_widget.display_target);
+        digest_value(&digest, ui.freq_widget.target_frequency);
+        digest_value(&digest, ui.freq_widget.is_cursor_locked);
+        digest_value(&digest, ui.freq_widget.locked_cursor_frequency);
+        digest_value(&digest, ui.freq_widget.display_window);
+        digest_value(&digest, ui.freq_widget.correct_answer_window);
+        digest_results(&digest, ui.results);
+        digest_string(&digest, ui.header_center_text);
+        digest_string(&digest, ui.header_right_text);
+        digest_value(&digest, ui.mix);
+        digest_value(&digest, ui.display_button);
+        digest_string(&digest, ui.button_text);
+        digest_value(&digest, ui.button_event);
+    }
+    if (effects.results)
+        digest_results(&digest, *effects.results);
+    if (effects.question_result)
+    {
+        const auto &result = *effects.question_result;
+        digest_value(&digest, result.timestamp);
+        digest_value(&digest, result.file_hash);
+        digest_value(&digest, result.response_time_ms);
+        digest_value(&digest, result.target_frequency);
+        digest_value(&digest, result.answer_frequency);
+        digest_value(&digest, result.distance);
+        digest_value(&digest, result.points);
+    }
+    const auto &state = effects.new_state;
+    digest_value(&digest, state.step);
+    digest_value(&digest, state.score);
+    digest_value(&digest, state.lives);
+    digest_value(&digest, state.target_frequency);
+    digest_value(&digest, state.correct_answer_window);
+    digest_value(&digest, state.is_prelistening);
+    digest_value(&digest, state.current_file_idx);
+    digest_value(&digest, state.question_count);
+    digest_value(&digest, state.answered_count);
+    digest_value(&digest, state.total_distance);
+    digest_value(&digest, state.total_response_time_ms);
+    digest_value(&digest, state.timestamp_start);
+    digest_value(&digest, state.question_timestamp);
+    return digest;
+}
+
 void frequency_widget_update(FrequencyWidget *widget, Frequency_Game_Effect_UI *new_ui)
 {
     widget->display_target = new_ui->freq_widget.display_target;
@@ -17,10 +17,28 @@ struct FrequencyGame_Results_Panel : public juce::Component
 struct FrequencyGame_Results
 {
     int score;
-    float analytics;
-    //temps moyen ? distance moyenne ? stats ?
+    int question_count;
+    //over the answered questions
+    float mean_distance;
+    float mean_response_time_ms;
+    int64_t timestamp;
 };
 
+//one per question, answered or timed out
+struct Frequency_Question_Result
+{
+    int64_t timestamp;
+    int64_t file_hash;
+    int64_t response_time_ms;
+    uint32_t target_frequency;
+    //0 when the question timed out
+    uint32_t answer_frequency;
+    //between the normalized frequencies, 1.0 when the question timed out
+    float distance;
+    int32_t points;
+};
+static_assert(std::is_trivially_copyable_v<Frequency_Question_Result>);
+
 
 struct Frequency_Game_Effect_UI {
     Effect_Transition transition;
@@ -92,13 +110,28 @@ struct FrequencyGame_State
     float correct_answer_window; 
     bool is_prelistening;
     //
+    //into FrequencyGame_Context::files
     uint32_t current_file_idx;
-    std::vector<Audio_File> files;
-    FrequencyGame_Config config;
     FrequencyGame_Results results;
+    int question_count;
+    int answered_count;
+    double total_distance;
+    int64_t total_response_time_ms;
 
     int64_t timestamp_start;
+    //when the question can be answered, after the prelistening
+    int64_t question_timestamp;
     int64_t current_timestamp;
+    Game_Random random;
+};
+//copied on every event, under the io mutex, it must not own any memory
+static_assert(std::is_trivially_copyable_v<FrequencyGame_State>);
+
+//what doesn't change during a game, built when the game starts and shared, never copied, by every update
+struct FrequencyGame_Context
+{
+    FrequencyGame_Config config;
+    std::vector<Audio_File> files;
 };
 
 struct Frequency_Game_Effects {
@@ -108,6 +141,7 @@ struct Frequency_Game_Effects {
     std::optional < Effect_Player > player;
     std::optional < Frequency_Game_Effect_UI > ui;
     std::optional < FrequencyGame_Results > results;
+    std::optional < Frequency_Question_Result > question_result;
     bool quit;
     FrequencyGame_State new_state;
 };
@@ -116,11 +150,19 @@ using frequency_game_observer_t = std::function<void(Frequency_Game_Effects*)>;
 
 struct FrequencyGame_IO
 {
+    std::shared_ptr<const FrequencyGame_Context> context;
     FrequencyGame_State game_state;
-    Timer timer;
     std::mutex update_fn_mutex;
+    //called on the game thread, for the audio
     std::vector<frequency_game_observer_t> observers;
+    //called on the message thread
+    std::vector<frequency_game_observer_t> ui_observers;
+    //message thread
     std::function < void() > on_quit;
+    //game thread, nullptr when recording is off
+    std::unique_ptr<Game_Recorder> recorder;
+    //last, stopped before the rest of the io goes away
+    std::unique_ptr<Game_Thread> game_thread;
 };
 
 
@@ -131,9 +173,22 @@ std::vector<FrequencyGame_Config> frequency_game_deserialize(std::string xml_str
 
 
 FrequencyGame_Config frequency_game_config_default(std::string name);
-FrequencyGame_State frequency_game_state_init(FrequencyGame_Config config, std::vector<Audio_File> *files);
-std::unique_ptr<FrequencyGame_IO> frequency_game_io_init(FrequencyGame_State);
+std::shared_ptr<const FrequencyGame_Context> frequency_game_context_init(FrequencyGame_Config config, std::vector<Audio_File> *files);
+FrequencyGame_State frequency_game_state_init(uint64_t seed);
+std::unique_ptr<FrequencyGame_IO> frequency_game_io_init(std::shared_ptr<const FrequencyGame_Context> context, FrequencyGame_State state);
+//before the first event is posted
 void frequency_game_add_observer(FrequencyGame_IO *io, frequency_game_observer_t observer);
+void frequency_game_add_ui_observer(FrequencyGame_IO *io, frequency_game_observer_t observer);
+//before the first event is posted, does nothing unless MIXTRAINER_RECORDINGS is set
+void frequency_game_record(FrequencyGame_IO *io);
 
+//any thread, the update runs on the game thread
 void frequency_game_post_event(FrequencyGame_IO *io, Event event);
-Frequency_Game_Effects frequency_game_update(FrequencyGame_State state, Event event);
+Frequency_Game_Effects frequency_game_update(const FrequencyGame_Context *context, FrequencyGame_State state, Event event);
+//when the state next needs an Event_Timer_Tick, -1 when it only waits for the user
+juce::int64 frequency_game_next_deadline(const FrequencyGame_Context *context, const FrequencyGame_State &state);
+
+std::string frequency_game_recording_setup(const FrequencyGame_Context *context);
+//nullptr when the setup can't be read
+std::shared_ptr<const FrequencyGame_Context> frequency_game_context_from_recording(const std::string &setup);
+uint64_t frequency_game_effects_digest(const Frequency_Game_Effects &effects);
@@ -72,3 +72,341 @@ Widget_Interaction_Type gameStepToFaderStep(GameStep game_step, Mix mix)
         };
     }
 }
+
+static bool game_thread_pop(Game_Thread *game_thread, Event *out)
+{
+    //single consumer, the position is only moved by the game thread
+    uint64_t position = game_thread->dequeue_position.load(std::memory_order_relaxed);
+    Game_Event_Cell *cell = &game_thread->cells[position & (game_event_capacity - 1)];
+    uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+    if (sequence != position + 1)
+        return false;
+    *out = std::move(cell->event);
+    game_thread->dequeue_position.store(position + 1, std::memory_order_relaxed);
+    cell->sequence.store(position + game_event_capacity, std::memory_order_release);
+    return true;
+}
+
+static void game_thread_process(Game_Thread *game_thread, Event event)
+{
+    event.timestamp = juce::Time::currentTimeMillis();
+    game_thread->deadline_ms = game_thread->process_event(std::move(event));
+}
+
+static void game_thread_flush_sliders(Game_Thread *game_thread)
+{
+    if (game_thread->pending_slider_count == 0)
+        return;
+    for (uint32_t i = 0; i < game_thread->pending_slider_count; i++)
+        game_thread_process(game_thread, std::move(game_thread->pending_sliders[i]));
+    game_thread->pending_slider_count = 0;
+    game_thread->last_slider_flush_ms = juce::Time::getMillisecondCounterHiRes();
+}
+
+//only the latest position of each control is kept, anything else first flushes them so that the order is preserved
+static void game_thread_handle_event(Game_Thread *game_thread, Event event)
+{
+    if (event.type != Event_Slider)
+    {
+        game_thread_flush_sliders(game_thread);
+        game_thread_process(game_thread, std::move(event));
+        return;
+    }
+    for (uint32_t i = 0; i < game_thread->pending_slider_count; i++)
+    {
+        if (game_thread->pending_sliders[i].id == event.id)
+        {
+            game_thread->pending_sliders[i] = std::move(event);
+            return;
+        }
+    }
+    if (game_thread->pending_slider_count == game_pending_slider_capacity)
+        game_thread_flush_sliders(game_thread);
+    game_thread->pending_sliders[game_thread->pending_slider_count++] = std::move(event);
+    //the first move after a pause goes through straight away
+    if (game_thread->pending_slider_count == 1 
+        && juce::Time::getMillisecondCounterHiRes() - game_thread->last_slider_flush_ms >= game_slider_interval_ms)
+        game_thread_flush_sliders(game_thread);
+}
+
+static void game_thread_loop(Game_Thread *game_thread)
+{
+    Event event;
+    while (!game_thread->should_exit.load(std::memory_order_acquire))
+    {
+        int timeout_ms = -1;
+        if (game_thread->deadline_ms != -1)
+            timeout_ms = static_cast<int>(std::clamp<juce::int64>(game_thread->deadline_ms - juce::Time::currentTimeMillis(), 0, std::numeric_limits<int>::max()));
+        if (game_thread->pending_slider_count > 0)
+        {
+            double remaining_ms = game_thread->last_slider_flush_ms + game_slider_interval_ms - juce::Time::getMillisecondCounterHiRes();
+            int slider_timeout_ms = std::max(0, static_cast<int>(std::ceil(remaining_ms)));
+            timeout_ms = timeout_ms == -1 ? slider_timeout_ms : std::min(timeout_ms, slider_timeout_ms);
+        }
+        game_thread->wake.wait(timeout_ms);
+        while (!game_thread->should_exit.load(std::memory_order_relaxed) && game_thread_pop(game_thread, &event))
+            game_thread_handle_event(game_thread, std::move(event));
+
+        if (game_thread->pending_slider_count > 0 
+            && juce::Time::getMillisecondCounterHiRes() - game_thread->last_slider_flush_ms >= game_slider_interval_ms)
+            game_thread_flush_sliders(game_thread);
+
+        juce::int64 now = juce::Time::currentTimeMillis();
+        if (game_thread->deadline_ms != -1 && now >= game_thread->deadline_ms)
+        {
+            game_thread->deadline_ms = -1;
+            game_thread_handle_event(game_thread, Event { .type = Event_Timer_Tick, .value_i64 = now });
+        }
+    }
+}
+
+std::unique_ptr<Game_Thread> game_thread_start(game_process_event_t process_event)
+{
+    auto game_thread = std::make_unique<Game_Thread>();
+    for (uint64_t i = 0; i < game_event_capacity; i++)
+        game_thread->cells[i].sequence.store(i, std::memory_order_relaxed);
+    game_thread->enqueue_position.store(0, std::memory_order_relaxed);
+    game_thread->dequeue_position.store(0, std::memory_order_relaxed);
+    game_thread->should_exit.store(false, std::memory_order_relaxed);
+    game_thread->pending_slider_count = 0;
+    game_thread->last_slider_flush_ms = 0.0;
+    game_thread->deadline_ms = -1;
+    game_thread->is_running = std::make_shared<bool>(true);
+    game_thread->process_event = std::move(process_event);
+    game_thread->thread = std::thread(game_thread_loop, game_thread.get());
+    return game_thread;
+}
+
+bool game_thread_post(Game_Thread *game_thread, Event event)
+{
+    uint64_t position = game_thread->enqueue_position.load(std::memory_order_relaxed);
+    Game_Event_Cell *cell;
+    for (;;)
+    {
+        cell = &game_thread->cells[position & (game_event_capacity - 1)];
+        uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int64_t difference = (int64_t)sequence - (int64_t)position;
+        if (difference == 0)
+        {
+            if (game_thread->enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        //full, the game thread is stuck
+        else if (difference < 0)
+        {
+            jassertfalse;
+            return false;
+        }
+        else
+            position = game_thread->enqueue_position.load(std::memory_order_relaxed);
+    }
+    cell->event = std::move(event);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    game_thread->wake.signal();
+    return true;
+}
+
+void game_thread_call_on_message_thread(Game_Thread *game_thread, std::function<void()> fn)
+{
+    juce::MessageManager::callAsync([is_running = game_thread->is_running, fn = std::move(fn)] {
+        if (*is_running)
+            fn();
+    });
+}
+
+void game_thread_stop(Game_Thread *game_thread)
+{
+    if (!game_thread->thread.joinable())
+        return;
+    *game_thread->is_running = false;
+    game_thread->should_exit.store(true, std::memory_order_release);
+    game_thread->wake.signal();
+    game_thread->thread.join();
+}
+
+juce::File game_recorder_directory()
+{
+    auto path = juce::SystemStats::getEnvironmentVariable("MIXTRAINER_RECORDINGS", {});
+    if (path.isEmpty() || !juce::File::isAbsolutePath(path))
+        return {};
+    return juce::File(path);
+}
+
+static const char *recording_game_names[] = { "none", "frequency", "compressor", "mixer" };
+
+std::unique_ptr<Game_Recorder> game_recorder_open(Recording_Game game, Game_Random random, const std::string &setup)
+{
+    juce::File directory = game_recorder_directory();
+    if (directory == juce::File{} || !directory.createDirectory())
+        return nullptr;
+    juce::File file = directory.getNonexistentChildFile(
+        juce::String(recording_game_names[game]) + "_" + juce::Time::getCurrentTime().formatted("%Y-%m-%d_%H-%M-%S"), 
+        ".recording", 
+        false);
+    //a small buffer, a crash only loses the last few events
+    auto stream = std::make_unique<juce::FileOutputStream>(file, 4096);
+    if (!stream->openedOk())
+    {
+        DBG("couldn't open " << file.getFullPathName());
+        return nullptr;
+    }
+    Recording_Header header = {
+        .magic = recording_magic,
+        .version = recording_version,
+        .game = game,
+        .setup_size = checked_cast<uint32_t>(setup.size()),
+        .random = random,
+        .timestamp = juce::Time::currentTimeMillis()
+    };
+    stream->write(&header, sizeof(header));
+    stream->write(setup.data(), setup.size());
+
+    auto recorder = std::make_unique<Game_Recorder>();
+    recorder->stream = std::move(stream);
+    return recorder;
+}
+
+void game_recorder_write(Game_Recorder *recorder, const Event &event, uint64_t effects_digest)
+{
+    Recorded_Event recorded = {
+        .timestamp = event.timestamp,
+        .value_i64 = event.value_i64,
+        .value_d = event.value_d,
+        .effects_digest = effects_digest,
+        .type = checked_cast<uint32_t>(event.type),
+        .id = event.id,
+        .value_i = event.value_i,
+        .value_u = event.value_u,
+        .value_f = event.value_f,
+        .value_f_2 = event.value_f_2,
+        .value_b = event.value_b ? uint8_t(1) : uint8_t(0),
+        .reserved = {}
+    };
+    recorder->stream->write(&recorded, sizeof(recorded));
+}
+
+bool recording_read(juce::File file, Recording *out)
+{
+    auto stream = file.createInputStream();
+    if (!stream || !stream->openedOk())
+        return false;
+    if (stream->read(&out->header, sizeof(out->header)) != sizeof(out->header)
+        || out->header.magic != recording_magic
+        || out->header.version != recording_version)
+        return false;
+
+    out->setup.resize(out->header.setup_size);
+    if (stream->read(out->setup.data(), checked_cast<int>(out->header.setup_size)) != checked_cast<int>(out->header.setup_size))
+        return false;
+
+    auto event_count = checked_cast<size_t>(stream->getNumBytesRemaining()) / sizeof(Recorded_Event);
+    out->events.resize(event_count);
+    auto byte_count = checked_cast<int>(event_count * sizeof(Recorded_Event));
+    return stream->read(out->events.data(), byte_count) == byte_count;
+}
+
+Event recorded_event_to_event(const Recorded_Event &recorded)
+{
+    return Event {
+        .type = static_cast<Event_Type>(recorded.type),
+        .id = recorded.id,
+        .value_b = recorded.value_b != 0,
+        .value_i = recorded.value_i,
+        .value_u = recorded.value_u,
+        .value_i64 = recorded.value_i64,
+        .value_f = recorded.value_f,
+        .value_f_2 = recorded.value_f_2,
+        .value_d = recorded.value_d,
+        .timestamp = recorded.timestamp
+    };
+}
+
+static const juce::Identifier id_recording_files = "files";
+static const juce::Identifier id_recording_file = "file";
+static const juce::Identifier id_recording_file_path = "path";
+static const juce::Identifier id_recording_file_title = "title";
+static const juce::Identifier id_recording_file_hash = "hash";
+static const juce::Identifier id_recording_file_loop_start = "loop_start_ms";
+static const juce::Identifier id_recording_file_loop_end = "loop_end_ms";
+static const juce::Identifier id_recording_file_length = "length_ms";
+static const juce::Identifier id_recording_file_max_level = "max_level";
+
+//what the updates read from the files, they aren't opened by the replay
+std::string recording_files_serialize(const std::vector<Audio_File> &files)
+{
+    juce::ValueTree root_node { id_recording_files };
+    for (const auto &file : files)
+    {
+        juce::ValueTree node = { id_recording_file, {
+            { id_recording_file_path, file.file.getFullPathName() },
+            { id_recording_file_title, juce::String(file.title) },
+            { id_recording_file_hash, juce::int64(file.hash) },
+            { id_recording_file_loop_start, juce::int64(file.loop_bounds_ms.getStart()) },
+            { id_recording_file_loop_end, juce::int64(file.loop_bounds_ms.getEnd()) },
+            { id_recording_file_length, juce::int64(file.file_length_ms) },
+            { id_recording_file_max_level, file.max_level },
+        } };
+        root_node.addChild(node, -1, nullptr);
+    }
+    return root_node.toXmlString().toStdString();
+}
+
+std::vector<Audio_File> recording_files_deserialize(const std::string &xml_string)
+{
+    std::vector<Audio_File> files{};
+    juce::ValueTree root_node = juce::ValueTree::fromXml(xml_string);
+    if (root_node.getType() != id_recording_files)
+        return files;
+    for (int i = 0; i < root_node.getNumChildren(); i++)
+    {
+        juce::ValueTree node = root_node.getChild(i);
+        if (node.getType() != id_recording_file)
+            continue;
+        juce::String path = node.getProperty(id_recording_file_path, "").toString();
+        files.push_back(Audio_File {
+            .is_valid = true,
+            .file = juce::File::isAbsolutePath(path) ? juce::File(path) : juce::File{},
+            .title = node.getProperty(id_recording_file_title, "").toString().toStdString(),
+            .loop_bounds_ms = { 
+                static_cast<juce::int64>(node.getProperty(id_recording_file_loop_start, 0)), 
+                static_cast<juce::int64>(node.getProperty(id_recording_file_loop_end, 0)) 
+            },
+            .freq_bounds = {},
+            .max_level = static_cast<float>(node.getProperty(id_recording_file_max_level, 1.0f)),
+            .file_length_ms = static_cast<juce::int64>(node.getProperty(id_recording_file_length, 0)),
+            .hash = static_cast<juce::int64>(node.getProperty(id_recording_file_hash, 0))
+        });
+    }
+    return files;
+}
+
+void digest_dsp(uint64_t *digest, const Channel_DSP_State &dsp)
+{
+    digest_value(digest, dsp.gain_db);
+    for (const auto &band : dsp.eq_bands)
+    {
+        digest_value(digest, band.type);
+        digest_value(digest, band.frequency);
+        digest_value(digest, band.quality);
+        digest_value(digest, band.gain);
+    }
+    digest_value(digest, dsp.comp.is_on);
+    digest_value(digest, dsp.comp.threshold_gain);
+    digest_value(digest, dsp.comp.ratio);
+    digest_value(digest, dsp.comp.attack);
+    digest_value(digest, dsp.comp.release);
+    digest_value(digest, dsp.comp.makeup_gain);
+}
+
+void digest_player(uint64_t *digest, const Effect_Player &player)
+{
+    for (const auto &command : player.commands)
+    {
+        digest_value(digest, command.type);
+        digest_value(digest, command.value_f);
+        digest_value(digest, command.value_i64);
+        digest_value(digest, command.loop_start_ms);
+        digest_value(digest, command.loop_end_ms);
+        digest_value(digest, command.value_file.hash);
+    }
+}
@@ -1,4 +1,6 @@
 #include <optional>
+#include <atomic>
+#include <thread>
 
 
 enum GameStep {
@@ -27,12 +29,52 @@ struct Effect_Transition {
 
 struct Effect_DSP_Single_Track {
     Channel_DSP_State dsp_state;
+    DSP_EQ_Gain_Ramp eq_gain_ramp;
 };
 
 struct Effect_Player {
     std::vector<Audio_Command> commands;
 };
 
+//PCG32 (O'Neill), owned by each game state so that an update only depends on its arguments
+//and a recording replays the same draws. 16 bytes, copied along with the state
+struct Game_Random
+{
+    uint64_t state;
+    uint64_t increment;
+};
+
+static inline uint32_t game_random_next(Game_Random *random)
+{
+    uint64_t old_state = random->state;
+    random->state = old_state * 6364136223846793005ull + random->increment;
+    uint32_t xorshifted = static_cast<uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+    uint32_t rotation = static_cast<uint32_t>(old_state >> 59u);
+    return (xorshifted >> rotation) | (xorshifted << ((0u - rotation) & 31u));
+}
+
+static inline Game_Random game_random_init(uint64_t seed)
+{
+    Game_Random random = { .state = 0, .increment = (seed << 1u) | 1u };
+    game_random_next(&random);
+    random.state += seed;
+    game_random_next(&random);
+    return random;
+}
+
+//in [0, max), multiply and shift (Lemire), the bias is far below what the games can show
+static inline uint32_t game_random_uint(Game_Random *random, uint32_t max)
+{
+    assert(max > 0);
+    return static_cast<uint32_t>((static_cast<uint64_t>(game_random_next(random)) * max) >> 32u);
+}
+
+//in [0, 1)
+static inline float game_random_float(Game_Random *random)
+{
+    return static_cast<float>(game_random_next(random) >> 8u) * (1.0f / 16777216.0f);
+}
+
 Widget_Interaction_Type gameStepToFaderStep(GameStep game_step, Mix mix);
 
 std::string step_to_str(GameStep step);
@@ -75,4 +117,159 @@ struct Event{
     char *value_cp;
     void *value_ptr;
     std::string value_str;
+    //currentTimeMillis, stamped by the game thread when the event is processed
+    juce::int64 timestamp;
+};
+
+//returns the next deadline of the game, currentTimeMillis, -1 when nothing is due
+using game_process_event_t = std::function<juce::int64(Event)>;
+
+static constexpr uint32_t game_event_capacity = 256;
+static_assert((game_event_capacity & (game_event_capacity - 1)) == 0);
+//a drag posts one Event_Slider per mouse move, a control is updated at most once per frame with its latest position
+static constexpr double game_slider_interval_ms = 1000.0 / 60.0;
+static constexpr uint32_t game_pending_slider_capacity = 8;
+
+struct Game_Thread;
+//message thread, the events still in the ring are dropped
+void game_thread_stop(Game_Thread *game_thread);
+
+struct Game_Event_Cell
+{
+    std::atomic<uint64_t> sequence;
+    Event event;
+};
+
+//runs the updates and the observers of one game, so that a slow paint can't hold back an audio effect.
+//the ui posts into a bounded lock-free ring (Vyukov), many producers, the game thread consumes.
+//there is no polling, the thread only wakes up for an event or for the deadline the game asked for,
+//where it processes an Event_Timer_Tick. a new deadline replaces, or cancels, the previous one.
+//what touches the ui is sent back to the message thread with game_thread_call_on_message_thread
+struct Game_Thread
+{
+    ~Game_Thread() { game_thread_stop(this); }
+
+    alignas(64) std::atomic<uint64_t> enqueue_position;
+    alignas(64) std::atomic<uint64_t> dequeue_position;
+    Game_Event_Cell cells[game_event_capacity];
+
+    juce::WaitableEvent wake;
+    std::atomic<bool> should_exit;
+    //game thread only, the slider events held back until the end of the frame, in arrival order, one per control
+    Event pending_sliders[game_pending_slider_capacity];
+    uint32_t pending_slider_count;
+    double last_slider_flush_ms;
+    //game thread only, -1 when nothing is due
+    juce::int64 deadline_ms;
+    //only read and written on the message thread, the calls still queued when the game stops are dropped
+    std::shared_ptr<bool> is_running;
+    game_process_event_t process_event;
+    std::thread thread;
+};
+
+std::unique_ptr<Game_Thread> game_thread_start(game_process_event_t process_event);
+//any thread, false when the ring is full
+bool game_thread_post(Game_Thread *game_thread, Event event);
+//game thread
+void game_thread_call_on_message_thread(Game_Thread *game_thread, std::function<void()> fn);
+
+
+//binary log of what a game's update saw, so that a session can be replayed headless, see Bench/Replay.cpp.
+//the events are written on the game thread once they are stamped and the sliders coalesced,
+//with a digest of the effects they produced, which the replay compares against
+enum Recording_Game : uint32_t
+{
+    Recording_Game_None = 0,
+    Recording_Game_Frequency,
+    Recording_Game_Compressor,
+    Recording_Game_Mixer
 };
+
+static constexpr uint32_t recording_magic = 0x4345524d; //"MREC"
+static constexpr uint32_t recording_version = 2;
+
+//followed by setup_size bytes, the xml the game's context or state is rebuilt from, then the events
+struct Recording_Header
+{
+    uint32_t magic;
+    uint32_t version;
+    Recording_Game game;
+    uint32_t setup_size;
+    //the generator of the state before the first event
+    Game_Random random;
+    int64_t timestamp;
+};
+static_assert(sizeof(Recording_Header) == 40);
+
+//value_str and the pointers aren't recorded, no update reads them
+struct Recorded_Event
+{
+    int64_t timestamp;
+    int64_t value_i64;
+    double value_d;
+    uint64_t effects_digest;
+    uint32_t type;
+    int32_t id;
+    int32_t value_i;
+    uint32_t value_u;
+    float value_f;
+    float value_f_2;
+    uint8_t value_b;
+    uint8_t reserved[7];
+};
+static_assert(sizeof(Recorded_Event) == 64);
+static_assert(std::is_trivially_copyable_v<Recorded_Event>);
+
+struct Game_Recorder
+{
+    std::unique_ptr<juce::FileOutputStream> stream;
+};
+
+struct Recording
+{
+    Recording_Header header;
+    std::string setup;
+    std::vector<Recorded_Event> events;
+};
+
+//the directory in MIXTRAINER_RECORDINGS, recording is off when it isn't set
+juce::File game_recorder_directory();
+//nullptr when recording is off or the file can't be created
+std::unique_ptr<Game_Recorder> game_recorder_open(Recording_Game game, Game_Random random, const std::string &setup);
+//game thread
+void game_recorder_write(Game_Recorder *recorder, const Event &event, uint64_t effects_digest);
+//a torn event at the end of the file is dropped
+bool recording_read(juce::File file, Recording *out);
+Event recorded_event_to_event(const Recorded_Event &recorded);
+
+std::string recording_files_serialize(const std::vector<Audio_File> &files);
+std::vector<Audio_File> recording_files_deserialize(const std::string &xml_string);
+
+//FNV-1a, fed field by field so that the padding never ends up in the digest
+static constexpr uint64_t digest_init = 14695981039346656037ull;
+
+static inline void digest_bytes(uint64_t *digest, const void *data, size_t size)
+{
+    auto *bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        *digest ^= bytes[i];
+        *digest *= 1099511628211ull;
+    }
+}
+
+template<typename T>
+static inline void digest_value(uint64_t *digest, T value)
+{
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+    digest_bytes(digest, &value, sizeof(T));
+}
+
+static inline void digest_string(uint64_t *digest, const std::string &string)
+{
+    digest_value(digest, string.size());
+    digest_bytes(digest, string.data(), string.size());
+}
+
+void digest_dsp(uint64_t *digest, const Channel_DSP_State &dsp);
+void digest_player(uint64_t *digest, const Effect_Player &player);
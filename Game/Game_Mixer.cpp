@@ -6,7 +6,16 @@
 #include "../Plugin_Host/Main_Menu.h"
 #include "../Plugin_Host/Application.h"
 
-void mixer_game_post_event(MixerGame_IO *io, Event event)
+juce::int64 mixer_game_next_deadline(const MixerGame_State &state)
+{
+    if (state.step == GameStep_Question 
+        && state.config.variant == MixerGame_Timer
+        && state.mix == Mix_Target)
+        return state.timestamp_start + state.config.timeout_ms;
+    return -1;
+}
+
+static juce::int64 mixer_game_process_event(MixerGame_IO *io, Event event)
 {
     Game_Mixer_Effects effects = mixer_game_update(io->game_state, event);
     assert(effects.error == 0);
@@ -14,12 +23,31 @@ void mixer_game_post_event(MixerGame_IO *io, Event event)
         std::lock_guard lock { io->mutex };
         io->game_state = effects.new_state;
     }
+    if (io->recorder)
+        game_recorder_write(io->recorder.get(), event, mixer_game_effects_digest(effects));
     for(auto &observer : io->observers)
         observer(effects);
-    if (effects.quit)
-    {
-        io->on_quit();
-    }
+
+    juce::int64 deadline = mixer_game_next_deadline(effects.new_state);
+    if (!effects.transition && !effects.dsp && !effects.ui && !effects.quit)
+        return deadline;
+    auto shared_effects = std::make_shared<Game_Mixer_Effects>(std::move(effects));
+    game_thread_call_on_message_thread(io->game_thread.get(), [io, shared_effects] {
+        for(auto &observer : io->ui_observers)
+            observer(*shared_effects);
+        //on_quit usually destroys the io
+        if (shared_effects->quit)
+        {
+            auto on_quit = io->on_quit;
+            on_quit();
+        }
+    });
+    return deadline;
+}
+
+void mixer_game_post_event(MixerGame_IO *io, Event event)
+{
+    game_thread_post(io->game_thread.get(), std::move(event));
 }
 
 Game_Mixer_Effects mixer_game_update(MixerGame_State state, Event event)
@@ -39,6 +67,8 @@ Game_Mixer_Effects mixer_game_update(MixerGame_State state, Event event)
     
     bool done_listening = false;
     bool check_answer = false;
+
+    state.current_timestamp = event.timestamp;
     
     switch (event.type)
     {
@@ -117,8 +147,6 @@ Game_Mixer_Effects mixer_game_update(MixerGame_State state, Event event)
         } break;
         case Event_Timer_Tick : 
         {
-            state.current_timestamp = event.value_i64;
-            
             if (state.step == GameStep_Question 
                 && state.config.variant == MixerGame_Timer
                 && state.mix == Mix_Target)
@@ -250,11 +278,12 @@ Game_Mixer_Effects mixer_game_update(MixerGame_State state, Event event)
             state.can_still_listen = true;
             for (auto i = 0; i < state.config.channel_infos.size(); i++)
             {
-                state.target_slider_pos[i] = random_uint(checked_cast<uint32_t>(state.config.db_slider_values.size()));
+                state.target_slider_pos[i] = game_random_uint(&state.random, checked_cast<uint32_t>(state.config.db_slider_values.size()));
                 state.edited_slider_pos[i] = checked_cast<uint32_t>(state.config.db_slider_values.size()) - 2;
             }
             if(state.target_slider_pos.size() != state.config.channel_infos.size()) assert(false);
             if(state.edited_slider_pos.size() != state.config.channel_infos.size()) assert(false);
+            state.question_timestamp = state.current_timestamp;
             
             switch (state.config.variant)
             {
@@ -406,12 +435,142 @@ void mixer_game_add_observer(MixerGame_IO *io, mixer_game_observer_t new_observe
     io->observers.push_back(std::move(new_observer));
 }
 
+void mixer_game_add_ui_observer(MixerGame_IO *io, mixer_game_observer_t new_observer)
+{
+    io->ui_observers.push_back(std::move(new_observer));
+}
+
+static const juce::Identifier id_recording_root = "mixer_recording";
+static const juce::Identifier id_recording_channel = "channel";
+static const juce::Identifier id_recording_channel_id = "id";
+static const juce::Identifier id_recording_channel_name = "name";
+static const juce::Identifier id_recording_channel_min_freq = "min_freq";
+static const juce::Identifier id_recording_channel_max_freq = "max_freq";
+static const juce::Identifier id_recording_db_slider_values = "db_slider_values";
+static const juce::Identifier id_recording_variant = "variant";
+static const juce::Identifier id_recording_listens = "listens";
+static const juce::Identifier id_recording_timeout_ms = "timeout_ms";
+
+std::string mixer_game_recording_setup(const MixerGame_State &state)
+{
+    juce::ValueTree root_node = { id_recording_root, {
+        { id_recording_db_slider_values, serialize_vector<double>(state.config.db_slider_values) },
+        { id_recording_variant, (int) state.config.variant },
+        { id_recording_listens, state.config.listens },
+        { id_recording_timeout_ms, state.config.timeout_ms },
+    } };
+    for (const auto &channel : state.config.channel_infos)
+    {
+        juce::ValueTree node = { id_recording_channel, {
+            { id_recording_channel_id, (juce::int64) channel.id },
+            { id_recording_channel_name, juce::String(channel.name) },
+            { id_recording_channel_min_freq, channel.min_freq },
+            { id_recording_channel_max_freq, channel.max_freq },
+        } };
+        root_node.addChild(node, -1, nullptr);
+    }
+    return root_node.toXmlString().toStdString();
+}
+
+bool mixer_game_state_from_recording(const std::string &setup, MixerGame_State *out)
+{
+    juce::ValueTree root_node = juce::ValueTree::fromXml(setup);
+    if (root_node.getType() != id_recording_root)
+        return false;
+    std::vector<Game_Channel> channel_infos{};
+    for (int i = 0; i < root_node.getNumChildren(); i++)
+    {
+        juce::ValueTree node = root_node.getChild(i);
+        if (node.getType() != id_recording_channel)
+            continue;
+        Game_Channel channel = {
+            .id = checked_cast<uint32_t>(static_cast<juce::int64>(node.getProperty(id_recording_channel_id, 0))),
+            .name = {},
+            .min_freq = node.getProperty(id_recording_channel_min_freq, 20.0f),
+            .max_freq = node.getProperty(id_recording_channel_max_freq, 20000.0f)
+        };
+        snprintf(channel.name, sizeof(channel.name), "%s", node.getProperty(id_recording_channel_name, "").toString().toRawUTF8());
+        channel_infos.push_back(channel);
+    }
+    if (channel_infos.empty())
+        return false;
+    *out = mixer_game_state_init(std::move(channel_infos),
+                                 (MixerGame_Variant)(int)root_node.getProperty(id_recording_variant, 0),
+                                 root_node.getProperty(id_recording_listens, -1),
+                                 root_node.getProperty(id_recording_timeout_ms, -1),
+                                 deserialize_vector<double>(root_node.getProperty(id_recording_db_slider_values, "")),
+                                 0);
+    return true;
+}
+
+void mixer_game_record(MixerGame_IO *io)
+{
+    io->recorder = game_recorder_open(Recording_Game_Mixer, io->game_state.random, mixer_game_recording_setup(io->game_state));
+}
+
+static void digest_slider_positions(uint64_t *digest, const std::vector<uint32_t> &positions)
+{
+    digest_value(digest, positions.size());
+    for (uint32_t position : positions)
+        digest_value(digest, position);
+}
+
+uint64_t mixer_game_effects_digest(const Game_Mixer_Effects &effects)
+{
+    uint64_t digest = digest_init;
+    digest_value(&digest, effects.error);
+    digest_value(&digest, effects.quit);
+    if (effects.transition)
+    {
+        digest_value(&digest, effects.transition->in_transition);
+        digest_value(&digest, effects.transition->out_transition);
+    }
+    if (effects.dsp)
+    {
+        //the map's order isn't part of the effect, the channels are summed
+        uint64_t dsp_digest = 0;
+        for (const auto &[id, dsp] : effects.dsp->dsp_states)
+        {
+            uint64_t channel_digest = digest_init;
+            digest_value(&channel_digest, id);
+            digest_dsp(&channel_digest, dsp);
+            dsp_digest += channel_digest;
+        }
+        digest_value(&digest, dsp_digest);
+    }
+    if (effects.ui)
+    {
+        const auto &ui = *effects.ui;
+        digest_string(&digest, ui.header_center_text);
+        digest_string(&digest, ui.header_right_text);
+        if (ui.slider_pos_to_display)
+            digest_slider_positions(&digest, *ui.slider_pos_to_display);
+        digest_value(&digest, ui.widget_visibility);
+        digest_value(&digest, ui.mix_toggles);
+        digest_value(&digest, ui.display_bottom_button);
+        digest_string(&digest, ui.bottom_button_text);
+        digest_value(&digest, ui.bottom_button_event);
+    }
+    const auto &state = effects.new_state;
+    digest_value(&digest, state.step);
+    digest_value(&digest, state.mix);
+    digest_value(&digest, state.score);
+    digest_slider_positions(&digest, state.edited_slider_pos);
+    digest_slider_positions(&digest, state.target_slider_pos);
+    digest_value(&digest, state.remaining_listens);
+    digest_value(&digest, state.can_still_listen);
+    digest_value(&digest, state.timestamp_start);
+    digest_value(&digest, state.question_timestamp);
+    return digest;
+}
+
 
 MixerGame_State mixer_game_state_init(std::vector<Game_Channel> channel_infos,
                                       MixerGame_Variant variant,
                                       int listens,
                                       int timeout_ms,
-                                      std::vector<double> db_slider_values)
+                                      std::vector<double> db_slider_values,
+                                      uint64_t seed)
 {
     if (variant != MixerGame_Tries)
         assert(listens == -1);
@@ -426,7 +585,8 @@ MixerGame_State mixer_game_state_init(std::vector<Game_Channel> channel_infos,
             .listens = listens,
             .timeout_ms = timeout_ms,
         },
-        .timestamp_start = -1
+        .timestamp_start = -1,
+        .random = game_random_init(seed)
     };
     return state;
 }
@@ -436,5 +596,8 @@ std::unique_ptr<MixerGame_IO> mixer_game_io_init(MixerGame_State state)
 {
     auto io = std::make_unique<MixerGame_IO>();
     io->game_state = state;
+    io->game_thread = game_thread_start([io = io.get()] (Event event) {
+        return mixer_game_process_event(io, std::move(event));
+    });
     return io;
 }
\ No newline at end of file
@@ -52,7 +52,9 @@ struct MixerGame_State {
     int remaining_listens;
     bool can_still_listen;
     int64_t timestamp_start;
+    int64_t question_timestamp;
     int64_t current_timestamp;
+    Game_Random random;
 };
 
 
@@ -69,21 +71,41 @@ using mixer_game_observer_t = std::function<void(const Game_Mixer_Effects &)>;
 struct MixerGame_IO
 {
     std::mutex mutex;
-    Timer timer;
+    //called on the game thread, for the audio
     std::vector<mixer_game_observer_t> observers;
+    //called on the message thread
+    std::vector<mixer_game_observer_t> ui_observers;
+    //message thread
     std::function<void()> on_quit;
     MixerGame_State game_state;
+    //game thread, nullptr when recording is off
+    std::unique_ptr<Game_Recorder> recorder;
+    //last, stopped before the rest of the io goes away
+    std::unique_ptr<Game_Thread> game_thread;
 };
 
 
+//any thread, the update runs on the game thread
 void mixer_game_post_event(MixerGame_IO *io, Event event);
 Game_Mixer_Effects mixer_game_update(MixerGame_State state, Event event);
+//when the state next needs an Event_Timer_Tick, -1 when it only waits for the user
+juce::int64 mixer_game_next_deadline(const MixerGame_State &state);
+//before the first event is posted
 void mixer_game_add_observer(MixerGame_IO *io, mixer_game_observer_t new_observer);
+void mixer_game_add_ui_observer(MixerGame_IO *io, mixer_game_observer_t new_observer);
+//before the first event is posted, does nothing unless MIXTRAINER_RECORDINGS is set
+void mixer_game_record(MixerGame_IO *io);
 
 MixerGame_State mixer_game_state_init(std::vector<Game_Channel> channel_infos,
                                       MixerGame_Variant variant,
                                       int listens,
                                       int timeout_ms,
-                                      std::vector<double> db_slider_values);
+                                      std::vector<double> db_slider_values,
+                                      uint64_t seed);
 
 std::unique_ptr<MixerGame_IO> mixer_game_io_init(MixerGame_State state);
+
+std::string mixer_game_recording_setup(const MixerGame_State &state);
+//false when the setup can't be read, the generator is in the Recording_Header
+bool mixer_game_state_from_recording(const std::string &setup, MixerGame_State *out);
+uint64_t mixer_game_effects_digest(const Game_Mixer_Effects &effects);
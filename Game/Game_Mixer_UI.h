@@ -86,4 +86,6 @@ struct MixerGameUI : public juce::Component
     GameUI_Header header;
     GameUI_Bottom bottom;
     MixerGame_IO *io;
+    //set by the host when the tracks report their levels
+    Timer level_timer;
 };
@@ -2,6 +2,8 @@
 #include "../shared/pch.h"
 #include "../shared/shared.h"
 #include "../shared/shared_ui.h"
+#include "../shared/transport.h"
+#include "../shared/audio.h"
 #include "../Game/Game.h"
 #include "../Game/Game_UI.h"
 #include "../Game/Game_Mixer.h"
@@ -23,6 +25,12 @@ Application::Application(ProcessorHost &processorHost) :
     multitrack_model_add_observer(&multitrack_model, 
                                   MultiTrack_Observers_Broadcast, 
                                   [&host = host] (auto *model) { host.broadcastChannelList(*model);});
+    model_change_timer.callback = [this] (juce::int64) { flush_model_change(); };
+
+    std::vector<std::string> level_names{};
+    for (double db : db_slider_values)
+        level_names.push_back(db <= -100.0 ? "Muted" : juce::Decibels::toString(db, 0).toStdString());
+    stats = stats_init(std::move(level_names));
 }
 
 
@@ -48,12 +56,12 @@ void Application::toMainMenu()
 }
 
 static void channel_dsp_log(const std::unordered_map<uint32_t, Channel_DSP_State> &dsps, 
-                    const std::unordered_map<uint32_t, Game_Channel> &channels)
+                    const std::vector<Game_Channel> &channels)
 {
     assert(dsps.size() == channels.size());
-    for (const auto& [id, channel] : channels)
+    for (const auto& channel : channels)
     {
-        assert(id == channel.id);
+        auto id = channel.id;
         assert(dsps.contains(id));
         const auto &dsp = dsps.at(id);
         juce::String db_str = juce::Decibels::toString(dsp.gain_db);
@@ -75,25 +83,18 @@ void Application::toGame(MixerGame_Variant variant)
     assert(!game_io);
     
     MixerGame_State new_game_state = [&] {
-        std::vector<Game_Channel> ordered_channels;
-        {
-            ordered_channels.reserve(multitrack_model.game_channels.size());
-            assert(multitrack_model.game_channels.size() == multitrack_model.order.size());
-            for (uint32_t id : multitrack_model.order)
-            {
-                ordered_channels.push_back(multitrack_model.game_channels.at(id));
-            }
-        }
+        std::vector<Game_Channel> ordered_channels = multitrack_model.game_channels;
+        auto seed = static_cast<uint64_t>(juce::Random::getSystemRandom().nextInt64());
         switch (variant)
         {
             case MixerGame_Normal : {
-                return mixer_game_state_init(std::move(ordered_channels), MixerGame_Normal, -1, -1, db_slider_values);
+                return mixer_game_state_init(std::move(ordered_channels), MixerGame_Normal, -1, -1, db_slider_values, seed);
             } break;
             case MixerGame_Timer : {
-                return mixer_game_state_init(std::move(ordered_channels), MixerGame_Timer, -1, 2000, db_slider_values);
+                return mixer_game_state_init(std::move(ordered_channels), MixerGame_Timer, -1, 2000, db_slider_values, seed);
             } break;
             case MixerGame_Tries : {
-                return mixer_game_state_init(std::move(ordered_channels), MixerGame_Tries, 5, -1, db_slider_values);
+                return mixer_game_state_init(std::move(ordered_channels), MixerGame_Tries, 5, -1, db_slider_values, seed);
             } break;
         }
         assert(false);
@@ -103,20 +104,20 @@ void Application::toGame(MixerGame_Variant variant)
     editor->changePanel(nullptr);
 
     auto observer = [this] (const Game_Mixer_Effects &effects)
+    {
+        if (effects.dsp)
+        {
+            broadcastDSP(effects.dsp->dsp_states); 
+        }
+    };
+
+    auto ui_observer = [this] (const Game_Mixer_Effects &effects)
     {
         if (effects.transition)
         {
             if (effects.transition->in_transition == GameStep_Begin)
             {
-                std::vector<Game_Channel> ordered_channels;
-                {
-                    ordered_channels.reserve(multitrack_model.game_channels.size());
-                    assert(multitrack_model.game_channels.size() == multitrack_model.order.size());
-                    for (uint32_t id : multitrack_model.order)
-                    {
-                        ordered_channels.push_back(multitrack_model.game_channels.at(id));
-                    }
-                }
+                std::vector<Game_Channel> ordered_channels = multitrack_model.game_channels;
 
                 auto new_game_ui = std::make_unique < MixerGameUI > (
                     ordered_channels,
@@ -124,19 +125,36 @@ void Application::toGame(MixerGame_Variant variant)
                     game_io.get()
                 );
                 game_ui = new_game_ui.get();
+                start_track_meters(game_ui);
                 editor->changePanel(std::move(new_game_ui));
             }
             if(game_ui)
                 mixer_game_ui_transitions(*game_ui, *effects.transition);
 
         }
-        if (effects.dsp)
+        if (effects.transition)
         {
-            broadcastDSP(effects.dsp->dsp_states); 
+            const MixerGame_State &state = effects.new_state;
+            if (effects.transition->in_transition == GameStep_Begin)
+            {
+                stats_begin_session(&stats);
+            }
+            //one result per fader
+            if (effects.transition->in_transition == GameStep_Result)
+            {
+                float response_time_ms = float(state.current_timestamp - state.question_timestamp);
+                for (size_t i = 0; i < state.target_slider_pos.size(); i++)
+                {
+                    uint32_t target = state.target_slider_pos[i];
+                    uint32_t edited = state.edited_slider_pos[i];
+                    float error = float(target > edited ? target - edited : edited - target);
+                    stats_add_result(&stats, target, target == edited, true, error, response_time_ms);
+                }
+            }
         }
-        if (effects.ui)
+        //the editor may have been closed while the effects were on their way from the game thread
+        if (effects.ui && game_ui)
         {
-            assert(game_ui);
             game_ui_update(*effects.ui, *game_ui); 
         }
     };
@@ -153,7 +171,6 @@ void Application::toGame(MixerGame_Variant variant)
     game_io = mixer_game_io_init(new_game_state);
     
     auto on_quit = [this] { 
-        game_io->timer.stopTimer();
         game_io.reset();  
         toMainMenu();
     };
@@ -161,12 +178,10 @@ void Application::toGame(MixerGame_Variant variant)
     game_io->on_quit = std::move(on_quit);
 
     mixer_game_add_observer(game_io.get(), std::move(observer));
-    mixer_game_add_observer(game_io.get(), std::move(debug_observer));
-    
-    game_io->timer.callback = [io = game_io.get()] (juce::int64 timestamp) {
-        mixer_game_post_event(io, Event {.type = Event_Timer_Tick, .value_i64 = timestamp});
-    };
-    game_io->timer.startTimerHz(60);
+    mixer_game_add_ui_observer(game_io.get(), std::move(ui_observer));
+    mixer_game_add_ui_observer(game_io.get(), std::move(debug_observer));
+    mixer_game_record(game_io.get());
+
 
     mixer_game_post_event(game_io.get(), Event { .type = Event_Init });
     mixer_game_post_event(game_io.get(), Event { .type = Event_Create_UI });
@@ -192,7 +207,7 @@ void Application::toStats()
     assert(editor);
     
     std::unique_ptr < juce::Component > settings_menu =
-        std::make_unique < StatsMenu > ([this] { toMainMenu(); }, stats);
+        std::make_unique < StatsMenu > ([this] { toMainMenu(); }, &stats);
     editor->changePanel(std::move(settings_menu));
 }
 
@@ -249,26 +264,20 @@ void Application::initialiseEditorUI(EditorHost *new_editor)
             panel = std::make_unique < SettingsMenu > ([this] { toMainMenu(); }, settings);
         } break;
         case Panel_Stats : {
-            panel = std::make_unique < StatsMenu > ([this] { toMainMenu(); }, stats);
+            panel = std::make_unique < StatsMenu > ([this] { toMainMenu(); }, &stats);
         } break;
         case Panel_Game :
         {
             assert(game_io); 
             
-            std::vector<Game_Channel> ordered_channels;
-            {
-                ordered_channels.reserve(multitrack_model.game_channels.size());
-                assert(multitrack_model.game_channels.size() == multitrack_model.order.size());
-                for (uint32_t id : multitrack_model.order)
-                {
-                    ordered_channels.push_back(multitrack_model.game_channels.at(id));
-                }
-            }
-            panel = std::make_unique<MixerGameUI>(
+            std::vector<Game_Channel> ordered_channels = multitrack_model.game_channels;
+            auto mixer_game_ui = std::make_unique<MixerGameUI>(
                 ordered_channels,
                 db_slider_values, //TODO ??
                 game_io.get()
             );
+            start_track_meters(mixer_game_ui.get());
+            panel = std::move(mixer_game_ui);
             mixer_game_post_event(game_io.get(), Event { .type = Event_Create_UI });
         } break;
     }
@@ -280,22 +289,46 @@ void Application::broadcastDSP(const std::unordered_map < uint32_t, Channel_DSP_
     host.broadcastAllDSP(dsp_states);
 }
 
+//a daw opening a project sends every track one after the other, the observers
+//then run once for all of them instead of once per track
+static constexpr int model_settle_ms = 30;
+static constexpr int model_settle_max_ms = 250;
+
+void Application::defer_model_change()
+{
+    auto now = juce::Time::currentTimeMillis();
+    if (model_change_pending_since == -1)
+        model_change_pending_since = now;
+    //a steady stream of commands still gets through
+    if (now - model_change_pending_since >= model_settle_max_ms)
+    {
+        flush_model_change();
+        return;
+    }
+    model_change_timer.startTimer(model_settle_ms);
+}
+
+void Application::flush_model_change()
+{
+    model_change_timer.stopTimer();
+    if (model_change_pending_since == -1)
+        return;
+    model_change_pending_since = -1;
+    multitrack_model_broadcast_change(&multitrack_model);
+}
+
 void Application::create_daw_channel(uint32_t daw_channel_id)
 {
     //DBG("action create " << daw_channel_id % 100 );
-    auto [it, result] = multitrack_model.daw_channels.emplace(daw_channel_id, Daw_Channel { .id = daw_channel_id, .assigned_game_channel_id = -1  });
-    assert(result);
-    multitrack_model_broadcast_change(&multitrack_model);
+    multitrack_model_add_daw_channel(&multitrack_model, daw_channel_id);
+    defer_model_change();
 }
     
 void Application::delete_daw_channel(uint32_t daw_channel_id)
 {    
-    //DBG("action delete " << daw_channel_id % 100 << " " << multitrack_model.daw_channels[daw_channel_id].name);
-    {
-        auto erased_count = multitrack_model.daw_channels.erase(daw_channel_id);
-        assert(erased_count == 1);
-    }
-    multitrack_model_broadcast_change(&multitrack_model);
+    //DBG("action delete " << daw_channel_id % 100);
+    multitrack_model_remove_daw_channel(&multitrack_model, daw_channel_id);
+    defer_model_change();
 }
     
 #if 0
@@ -316,63 +349,85 @@ void Application::renameChannelFromUI(uint32_t id, juce::String new_name)
 void Application::rename_daw_channel(uint32_t daw_channel_id, const juce::String &new_name)
 {
     //DBG("action rename " << daw_channel_id % 100 << " " << daw_channel.name << " into " << new_name);
-    auto &daw_channel = multitrack_model.daw_channels.at(daw_channel_id);
+    Daw_Channel *daw_channel = multitrack_model_find_daw_channel(&multitrack_model, daw_channel_id);
+    assert(daw_channel);
 
     new_name.copyToUTF8(
-        daw_channel.name,
-        sizeof(daw_channel.name)
+        daw_channel->name,
+        sizeof(daw_channel->name)
     );
-    multitrack_model_broadcast_change(&multitrack_model);
+    defer_model_change();
 }
     
 void Application::change_frequency_range_from_daw(uint32_t daw_channel_id, uint32_t game_channel_id, float new_min, float new_max)
 {
     //DBG("action frequency " << daw_channel_id % 100);
-    auto &daw_channel = multitrack_model.daw_channels.at(daw_channel_id);
-    assert(daw_channel.assigned_game_channel_id != -1);
-    assert(daw_channel.assigned_game_channel_id == game_channel_id);
-    auto &game_channel = multitrack_model.game_channels.at(game_channel_id);
+    Daw_Channel *daw_channel = multitrack_model_find_daw_channel(&multitrack_model, daw_channel_id);
+    assert(daw_channel);
+    assert(daw_channel->assigned_game_channel_id != -1);
+    assert(daw_channel->assigned_game_channel_id == game_channel_id);
+    int game_channel_index = multitrack_model_find_game_channel(&multitrack_model, game_channel_id);
+    assert(game_channel_index != -1);
+    auto &game_channel = multitrack_model.game_channels[checked_cast<size_t>(game_channel_index)];
     game_channel.min_freq = new_min;
     game_channel.max_freq = new_max;
-    multitrack_model_broadcast_change(&multitrack_model);
+    defer_model_change();
 }
 
 
-void Application::bind_daw_channel_with_game_channel(uint32_t daw_channel_id, uint32_t game_channel_id)
+void Application::bind_daw_channel_with_game_channel(uint32_t daw_channel_id, int64_t game_channel_id)
 {
     //DBG("action bind " << daw_channel_id % 100 << " " << game_channel_id % 100);
-    assert(multitrack_model.daw_channels.contains(daw_channel_id));
-    multitrack_model.daw_channels.at(daw_channel_id).assigned_game_channel_id = game_channel_id;
-    if (game_channel_id != -1)
-    {
-        //assert(multitrack_model.game_channels.contains(game_channel_id));
-    }
-    multitrack_model_broadcast_change(&multitrack_model);
+    assert(has_daw_channel(daw_channel_id));
+    multitrack_model_bind(&multitrack_model, daw_channel_id, game_channel_id);
+    defer_model_change();
+}
+
+void Application::start_track_meters(MixerGameUI *ui)
+{
+    if (!host.transport)
+        return;
+    //the timer belongs to the ui, it stops with it
+    ui->level_timer.callback = [this, ui] (juce::int64) {
+        //the faders follow the model's order, several daw channels can feed the same one
+        std::vector<float> peak_db(ui->faders.size(), -100.0f);
+        std::vector<double> power(ui->faders.size(), 0.0);
+        for (const auto &level : host.read_track_levels())
+        {
+            Daw_Channel *daw_channel = multitrack_model_find_daw_channel(&multitrack_model, level.daw_channel_id);
+            if (!daw_channel)
+                continue;
+            int fader = multitrack_model_find_game_channel(&multitrack_model, daw_channel->assigned_game_channel_id);
+            if (fader == -1 || fader >= (int)ui->faders.size())
+                continue;
+            peak_db[fader] = std::max(peak_db[fader], level.peak_db);
+            double rms = juce::Decibels::decibelsToGain(level.rms_db);
+            power[fader] += rms * rms;
+        }
+        for (size_t i = 0; i < ui->faders.size(); i++)
+        {
+            float rms_db = juce::Decibels::gainToDecibels(static_cast<float>(std::sqrt(power[i])));
+            ui->faders[i]->set_level(peak_db[i], rms_db);
+        }
+    };
+    ui->level_timer.startTimerHz(30);
+}
+
+bool Application::has_daw_channel(uint32_t daw_channel_id) const
+{
+    return multitrack_model.daw_channel_indices.contains(daw_channel_id);
 }
 
 void Application::set_model(const std::vector<Game_Channel> &channels)
 {
-    auto size = channels.size();
-    juce::ignoreUnused(size);
-    assert(multitrack_model.game_channels.size() == multitrack_model.order.size());
-    multitrack_model.game_channels.clear();
-    multitrack_model.order.clear();
-    for (const auto& channel : channels)
-    {
-        multitrack_model.game_channels.emplace(channel.id, channel);
-        multitrack_model.order.push_back(channel.id);
-    }
+    multitrack_model_set_game_channels(&multitrack_model, channels);
     DBG("SET");
+    model_change_pending_since = -1;
+    model_change_timer.stopTimer();
     multitrack_model_broadcast_change(&multitrack_model);
 }
 
 std::vector<Game_Channel> Application::save_model()
 {
-    assert(multitrack_model.game_channels.size() == multitrack_model.order.size());
-    std::vector<Game_Channel> out_vector{};
-    for (const auto& channel_id : multitrack_model.order)
-    {
-        out_vector.push_back(multitrack_model.game_channels.at(channel_id));
-    }
-    return out_vector;
+    return multitrack_model.game_channels;
 }
\ No newline at end of file
@@ -17,13 +17,13 @@ public:
     void toSettings();
     
     //TODO rename
-    static std::unordered_map < uint32_t, Channel_DSP_State > bypassedAllChannelsDSP(const std::unordered_map<uint32_t, Game_Channel> &channels) {
+    static std::unordered_map < uint32_t, Channel_DSP_State > bypassedAllChannelsDSP(const std::vector<Game_Channel> &channels) {
         std::unordered_map < uint32_t, Channel_DSP_State > dsp_states;
         
         std::transform(channels.begin(), channels.end(), 
                        std::inserter(dsp_states, dsp_states.end()), 
                        [](const auto &a) -> std::pair<uint32_t, Channel_DSP_State>{
-                       return { a.first, ChannelDSP_on() };
+                       return { a.id, ChannelDSP_on() };
         });
         return dsp_states;
     }
@@ -35,9 +35,14 @@ public:
     //void renameChannelFromUI(int id, juce::String newName);
     void rename_daw_channel(uint32_t id, const juce::String &new_name);
     void change_frequency_range_from_daw(uint32_t daw_channel_id, uint32_t game_channel_id, float new_min, float new_max);
-    void bind_daw_channel_with_game_channel(uint32_t daw_track_id, uint32_t game_track_id);
+    void bind_daw_channel_with_game_channel(uint32_t daw_track_id, int64_t game_track_id);
+    bool has_daw_channel(uint32_t daw_channel_id) const;
+    void start_track_meters(MixerGameUI *ui);
     void set_model(const std::vector<Game_Channel> &channels);
     std::vector<Game_Channel> save_model();
+    //the changes coming from the tracks wait for the commands to settle before the observers run
+    void defer_model_change();
+    void flush_model_change();
 
 private:
     enum PanelType{
@@ -51,9 +56,12 @@ private:
     std::vector<double> db_slider_values { -100.0, -12.0, -9.0, -6.0, -3.0 };
     std::unique_ptr<MixerGame_IO> game_io;
     MuliTrack_Model multitrack_model;
+    Timer model_change_timer;
+    juce::int64 model_change_pending_since = -1;
     MixerGameUI *game_ui;
     Settings settings = { 0.0f };
-    Stats stats = { 0 };
+    //in memory only, the plugin has no results store, reloading it starts the stats over
+    Stats stats;
     PanelType type;
     ProcessorHost &host;
 
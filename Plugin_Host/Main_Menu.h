@@ -42,7 +42,6 @@ public :
         
         stats_button.setSize(100, 40);
         stats_button.setButtonText("Statistics");
-        stats_button.setEnabled(false);
         stats_button.onClick = [click = std::move(toStatsButtonClick)] {
             click();
         };
@@ -59,7 +58,7 @@ public :
         auto model_observer = [&] (MuliTrack_Model *model)
         {
             bool is_valid = true;
-            for (auto &[game_channel_id, assigned_count] : model->assigned_daw_track_count)
+            for (int assigned_count : model->assigned_daw_track_count)
             {
                 if (assigned_count != 1)
                 {
@@ -135,39 +134,26 @@ public :
         };
         
         channel_list.create_channel_callback = [&](juce::String new_channel_name){
-            uint32_t new_channel_id = random_uint();
-            Game_Channel new_channel = {
-                .id = new_channel_id,
-            };
+            Game_Channel new_channel = {};
             new_channel_name.copyToUTF8(new_channel.name, sizeof(new_channel.name));
-            {
-                auto [it, result] = multitrack_model.game_channels.emplace(new_channel_id, new_channel);
-                assert(result);
-            }
-            multitrack_model.order.push_back(new_channel_id);
+            multitrack_model_add_game_channel(&multitrack_model, new_channel);
             multitrack_model_broadcast_change(&multitrack_model);
         };
 
         channel_list.delete_channel_callback = [&](int row_to_delete){
-            auto id = multitrack_model.order.at(row_to_delete);
-            multitrack_model.order.erase(multitrack_model.order.begin() + row_to_delete);
-            {
-                auto deleted_count = multitrack_model.game_channels.erase(id);
-                assert(deleted_count == 1);
-            }
+            auto id = multitrack_model.game_channels.at(row_to_delete).id;
+            multitrack_model_remove_game_channel(&multitrack_model, id);
             multitrack_model_broadcast_change(&multitrack_model);
         };
 
         channel_list.rename_channel_callback = [&](int row_idx, juce::String new_channel_name){
-            int channel_id = multitrack_model.order.at(row_idx);
-            auto& channel_to_rename = multitrack_model.game_channels.at(channel_id);
+            auto& channel_to_rename = multitrack_model.game_channels.at(row_idx);
             new_channel_name.copyToUTF8(channel_to_rename.name, sizeof(channel_to_rename.name));
             multitrack_model_broadcast_change(&multitrack_model);
         };
 
         channel_list.customization_point = [&](int row_idx, List_Row_Label* label){
-            int channel_id = multitrack_model.order.at(row_idx);
-            bool only_one_daw_track = multitrack_model.assigned_daw_track_count.at(channel_id) == 1;
+            bool only_one_daw_track = multitrack_model.assigned_daw_track_count.at(row_idx) == 1;
             juce::Colour colour = only_one_daw_track 
                 ? juce::Colours::white
                 : juce::Colours::red;
@@ -177,10 +163,10 @@ public :
         auto multitrack_observer = [&](MuliTrack_Model *new_model) { 
             std::vector<std::string> channel_names{};
             channel_names.resize(new_model->game_channels.size());
-            auto projection = [new_model] (int id) {
-                return new_model->game_channels.at(id).name;
+            auto projection = [] (const Game_Channel &channel) {
+                return channel.name;
             };
-            std::transform(new_model->order.begin(), new_model->order.end(), channel_names.begin(), std::move(projection));
+            std::transform(new_model->game_channels.begin(), new_model->game_channels.end(), channel_names.begin(), std::move(projection));
             channel_list.update(channel_names);
         };
         multitrack_observer(&multitrack_model);
@@ -279,9 +265,9 @@ class StatsMenu : public juce::Component
 {
 public :
     StatsMenu(std::function < void() > && onBackButtonClick,
-              Stats mixerGameStats) :
+              const Stats *mixerGameStats) :
         back_button_callback(std::move(onBackButtonClick)),
-        stats(mixerGameStats)
+        stats_table("Faders, by target level", mixerGameStats, "steps")
     {
         back_button.setButtonText("back");
         back_button.onClick = [this] {
@@ -289,10 +275,7 @@ public :
         };
         addAndMakeVisible(back_button);
 
-        test_stat_label.setText(juce::String(stats.total_score), juce::dontSendNotification);
-        test_stat_label.setSize(300, 50);
-        test_stat_label.setJustificationType(juce::Justification::centredLeft);
-        addAndMakeVisible(test_stat_label);
+        addAndMakeVisible(stats_table);
     }
     
     void paint(juce::Graphics &g) override
@@ -310,13 +293,11 @@ public :
         auto backButtonBounds = top_bounds.withWidth(90);
         back_button.setBounds(backButtonBounds);
         
-        test_stat_label.setCentrePosition(r.getCentre());
+        stats_table.setBounds(r.withTrimmedTop(top_height + 10).reduced(20, 0));
     }
 
 private :
     juce::TextButton back_button;
-    juce::Slider slider;
-    juce::Label test_stat_label;
     std::function < void() > back_button_callback;
-    Stats stats;
+    Stats_Table stats_table;
 };
\ No newline at end of file
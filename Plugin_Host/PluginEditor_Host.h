@@ -10,6 +10,48 @@
 
 #pragma once
 
+//mix bus level, polled from the processor at ui rate
+class Bus_Level_Meter : public juce::Component, juce::Timer
+{
+public:
+    Bus_Level_Meter(std::function < Level_Meter_Values() > && readValues)
+    :   read_values(std::move(readValues))
+    {
+        startTimerHz(30);
+    }
+
+    void timerCallback() override
+    {
+        values = read_values();
+        repaint();
+    }
+
+    void paint(juce::Graphics &g) override
+    {
+        auto text_bounds = getLocalBounds().removeFromBottom(16);
+        auto bar_bounds = getLocalBounds().withTrimmedBottom(16).reduced(4).toFloat();
+        auto db_to_y = [&] (float db) {
+            return juce::jmap(juce::jlimit(-60.0f, 0.0f, db), -60.0f, 0.0f, bar_bounds.getBottom(), bar_bounds.getY());
+        };
+
+        g.setColour(juce::Colours::black);
+        g.fillRect(bar_bounds);
+        g.setColour(juce::Colours::green);
+        g.fillRect(bar_bounds.withTop(db_to_y(values.rms_db)));
+        g.setColour(values.peak_db > -0.1f ? juce::Colours::red : juce::Colours::yellow);
+        g.drawHorizontalLine(juce::roundToInt(db_to_y(values.peak_db)), bar_bounds.getX(), bar_bounds.getRight());
+
+        g.setColour(juce::Colours::white);
+        g.setFont(10.0f);
+        auto lufs_text = values.short_term_lufs > -70.0f ? juce::String(values.short_term_lufs, 0) : juce::String("-inf");
+        g.drawText(lufs_text, text_bounds, juce::Justification::centred);
+    }
+
+private:
+    std::function < Level_Meter_Values() > read_values;
+    Level_Meter_Values values = { -100.0f, -100.0f, -100.0f };
+};
+
 class EditorHost : public juce::AudioProcessorEditor
 {
 public:
@@ -17,8 +59,10 @@ public:
     EditorHost(ProcessorHost& p, std::function < void() > && onEditorClose)
     :    AudioProcessorEditor(p),
          audio_processor(p),
-         editor_close_callback(std::move(onEditorClose))
+         editor_close_callback(std::move(onEditorClose)),
+         bus_level_meter([&p] { return p.read_bus_meter(); })
     {
+        addAndMakeVisible(bus_level_meter);
         setResizable(true, false);
         setSize(960, 540);
     }
@@ -35,9 +79,11 @@ public:
     
     void resized() override
     {
+        auto bounds = getLocalBounds();
+        bus_level_meter.setBounds(bounds.removeFromRight(32));
         if (current_panel)
         {
-            current_panel->setBounds(getLocalBounds());
+            current_panel->setBounds(bounds);
         }
     }
     
@@ -55,6 +101,7 @@ public:
     std::unique_ptr<juce::Component> current_panel;
     ProcessorHost &audio_processor;
     std::function < void() > editor_close_callback;
+    Bus_Level_Meter bus_level_meter;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EditorHost)
 };
\ No newline at end of file
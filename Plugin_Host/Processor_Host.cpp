@@ -12,6 +12,8 @@
 
 #include "../shared/shared.h"
 #include "../shared/shared_ui.h"
+#include "../shared/transport.h"
+#include "../shared/audio.h"
 #include "../Game/Game.h"
 #include "../Game/Game_UI.h"
 #include "../Game/Game_Mixer.h"
@@ -36,11 +38,67 @@ ProcessorHost::ProcessorHost()
     app(*this)
 {
     juce::MessageManager::getInstance()->registerBroadcastListener(this);
+    channel_list_snapshot_timer.callback = [this] (juce::int64) { broadcastChannelListSnapshot(); };
+    open_transport();
+    transport_timer.callback = [this] (juce::int64) {
+        //a second host takes over the segment once its owner is gone
+        if (transport && (transport_is_retired(transport.get()) || (!transport->is_owner && !transport_is_host_alive(transport.get()))))
+            close_transport();
+        //no sleeping on the message thread, a host busy with the segment or a failure is retried a few ticks later
+        if (!transport && --transport_open_countdown <= 0)
+        {
+            transport_open_countdown = 25;
+            open_transport();
+        }
+        if (!transport)
+            return;
+        transport_host_heartbeat(transport.get());
+        //a track process which crashed or was killed never releases its slot
+        transport_reclaim_stale_meter_slots(transport.get());
+        Transport_Command command;
+        while (transport_pop_command(transport.get(), &command))
+        {
+            //a second host shares the ring, it may hand over commands for channels this one already knows.
+            //it doesn't publish, the tracks in other processes only get the owner's dsp and channel list
+            bool is_known = app.has_daw_channel(command.daw_channel_id);
+            if (is_known != (command.type == Transport_Command_Create))
+                handle_command(command);
+        }
+    };
+    transport_timer.startTimer(20);
 }
 
 ProcessorHost::~ProcessorHost()
 {
     juce::MessageManager::getInstance()->deregisterBroadcastListener(this);
+    transport_timer.stopTimer();
+    //app is destroyed after this body, its game thread may still be in broadcastAllDSP publishing to the transport
+    if (app.game_io)
+        game_thread_stop(app.game_io->game_thread.get());
+    if (transport)
+        close_transport();
+}
+
+void ProcessorHost::open_transport()
+{
+    auto new_transport = transport_open(Transport_Role_Host);
+    if (!new_transport)
+        return;
+    std::lock_guard lock { dsp_mutex };
+    //the tracks reattach to a new segment and register again, what was already sent goes there first
+    for (const auto &[id, state] : last_dsp_states)
+        transport_publish_dsp(new_transport.get(), id, { .dsp = state, .apply_at_sample = -1, .params = channel_dsp_make_params(state, host_sample_rate()) });
+    transport_publish_channel_list(new_transport.get(), sent_channel_list);
+    transport_host_heartbeat(new_transport.get());
+    transport = std::move(new_transport);
+}
+
+void ProcessorHost::close_transport()
+{
+    //the game thread publishes under the same lock
+    std::lock_guard lock { dsp_mutex };
+    transport_close(transport.get());
+    transport.reset();
 }
 
 //==============================================================================
@@ -111,7 +169,8 @@ void ProcessorHost::changeProgramName(int index, const juce::String& newName)
 //==============================================================================
 void ProcessorHost::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    juce::ignoreUnused(sampleRate, samplesPerBlock);
+    playhead_sample_rate.store(sampleRate);
+    bus_meter_prepare(&bus_meter, sampleRate, samplesPerBlock);
 }
 
 void ProcessorHost::releaseResources()
@@ -150,6 +209,11 @@ void ProcessorHost::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuf
     juce::ScopedNoDenormals noDenormals;
     //auto totalNumInputChannels = getTotalNumInputChannels();
     //auto totalNumOutputChannels = getTotalNumOutputChannels();
+    playhead_sample.store(playhead_sample_position(getPlayHead()), std::memory_order_relaxed);
+
+    Level_Meter_Values values;
+    if (bus_meter_process(&bus_meter, buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples(), &values))
+        seqlock_write(&bus_meter_sequence, &bus_meter_values, values);
 }
 
 //==============================================================================
@@ -197,39 +261,91 @@ void ProcessorHost::setStateInformation(const void* data, int sizeInBytes)
 }
 
 void ProcessorHost::actionListenerCallback(const juce::String& message) {
+    //the host's own broadcasts, not worth tokenizing
+    if (message.startsWith("dsp_batch ") || message.startsWith("channel_list"))
+    {
+        if (message.startsWith("channel_list_request "))
+            request_channel_list_snapshot();
+        return;
+    }
     juce::StringArray tokens = juce::StringArray::fromTokens(message, " ", "\"");
     
 
     assert(tokens.size() >= 2);
-    int daw_channel_id = tokens[1].getIntValue();
+    Transport_Command command = {};
+    command.daw_channel_id = checked_cast<uint32_t>(tokens[1].getLargeIntValue());
     
     if (tokens[0] == "create") 
     {
-        app.create_daw_channel(daw_channel_id);
+        command.type = Transport_Command_Create;
     }
     else if (tokens[0] == "delete") 
     {
-       app.delete_daw_channel(daw_channel_id);
+        command.type = Transport_Command_Delete;
     }
     else if (tokens[0] == "name_from_track")
     {
-        app.rename_daw_channel(daw_channel_id, tokens[2]);
+        command.type = Transport_Command_Rename;
+        tokens[2].copyToUTF8(command.name, sizeof(command.name));
     }
     else if (tokens[0] == "frequency_range")
     {
-        auto game_channel_id = tokens[2].getIntValue();
-        auto minFreq = tokens[3].getFloatValue();
-        auto maxFreq = tokens[4].getFloatValue();
-        app.change_frequency_range_from_daw(daw_channel_id, game_channel_id, minFreq, maxFreq);
+        command.type = Transport_Command_Frequency_Range;
+        command.game_channel_id = tokens[2].getLargeIntValue();
+        command.min_frequency = tokens[3].getFloatValue();
+        command.max_frequency = tokens[4].getFloatValue();
     }
     else if (tokens[0] == "select_game_channel")
     {
-        auto game_channel_id = tokens[2].getIntValue();
-        app.bind_daw_channel_with_game_channel(daw_channel_id, game_channel_id);
+        command.type = Transport_Command_Select_Game_Channel;
+        command.game_channel_id = tokens[2].getLargeIntValue();
     }
+    else return;
+    handle_command(command);
 }
 
+void ProcessorHost::handle_command(const Transport_Command &command)
+{
+    switch (command.type)
+    {
+        case Transport_Command_Create :
+        {
+            //the track reads the list from the shared memory, or asks for a snapshot when it has neither
+            app.create_daw_channel(command.daw_channel_id);
+        } break;
+        case Transport_Command_Delete :
+        {
+            app.delete_daw_channel(command.daw_channel_id);
+        } break;
+        case Transport_Command_Rename :
+        {
+            app.rename_daw_channel(command.daw_channel_id, juce::String::fromUTF8(command.name));
+        } break;
+        case Transport_Command_Frequency_Range :
+        {
+            app.change_frequency_range_from_daw(command.daw_channel_id, static_cast<uint32_t>(command.game_channel_id), command.min_frequency, command.max_frequency);
+        } break;
+        case Transport_Command_Select_Game_Channel :
+        {
+            app.bind_daw_channel_with_game_channel(command.daw_channel_id, command.game_channel_id);
+            std::lock_guard lock { dsp_mutex };
+            auto it = last_dsp_states.find(static_cast<uint32_t>(command.game_channel_id));
+            if (it != last_dsp_states.end())
+            {
+                juce::MessageManager::getInstance()->broadcastMessage(dsp_batch_message({ { .game_channel_id = it->first, .dsp = it->second, .params = channel_dsp_make_params(it->second, host_sample_rate()) } }, -1));
+            }
+        } break;
+        case Transport_Command_None :
+        {
+            jassertfalse;
+        } break;
+    }
+}
+
+//the bench builds the host and the tracks into one executable
+#if ! MIXTRAINER_HEADLESS
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new ProcessorHost();
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -59,33 +59,164 @@ class ProcessorHost : public juce::AudioProcessor, public juce::ActionListener
     void setStateInformation(const void* data, int sizeInBytes) override;
     
 
+    //only the channels which changed since the last update are sent, as one message.
+    //called from the game thread, the shared memory is written straight away, the in process broadcast goes through the message thread
     void broadcastAllDSP(const std::unordered_map<uint32_t, Channel_DSP_State> &dsp_states)
     {
-        for (const auto &[id, state] : dsp_states)
+        std::vector<DSP_Batch_Entry> changed;
+        int64_t apply_at_sample;
         {
-            auto message = juce::String("dsp ") + juce::String(id) + " " + juce::String::toHexString((void*)&state, sizeof(state), 0);
-            juce::MessageManager::getInstance()->broadcastMessage(message);
+            std::lock_guard lock { dsp_mutex };
+            for (const auto &[id, state] : dsp_states)
+            {
+                auto it = last_dsp_states.find(id);
+                if (it != last_dsp_states.end() && channel_dsp_equal(it->second, state))
+                    continue;
+                last_dsp_states[id] = state;
+                //once here, for all the tracks bound to the channel
+                changed.push_back({ .game_channel_id = id, .dsp = state, .params = channel_dsp_make_params(state, host_sample_rate()) });
+            }
+            if (changed.empty())
+                return;
+            apply_at_sample = next_dsp_switch_sample();
+            if (transport)
+            {
+                for (const auto &entry : changed)
+                    transport_publish_dsp(transport.get(), entry.game_channel_id, { .dsp = entry.dsp, .apply_at_sample = apply_at_sample, .params = entry.params });
+            }
         }
+        auto message = dsp_batch_message(changed, apply_at_sample);
+        //the windows broadcast waits on the message thread
+        if (juce::MessageManager::getInstance()->isThisTheMessageThread())
+            juce::MessageManager::getInstance()->broadcastMessage(message);
+        else
+            juce::MessageManager::callAsync([message] { juce::MessageManager::getInstance()->broadcastMessage(message); });
+    }
+
+    //ui rate, for the level display and anything scoring on the real mix
+    Level_Meter_Values read_bus_meter()
+    {
+        Level_Meter_Values values;
+        if (!seqlock_read(&bus_meter_sequence, &bus_meter_values, &values))
+            return { -100.0f, -100.0f, -100.0f };
+        return values;
+    }
+
+    //ui rate, empty without the shared memory
+    std::vector<Track_Level> read_track_levels()
+    {
+        if (!transport)
+            return {};
+        return transport_read_track_levels(transport.get());
     }
 
+    //the tracks normally run at the same rate as the host
+    double host_sample_rate()
+    {
+        return playhead_sample_rate.load(std::memory_order_relaxed);
+    }
+
+    //far enough ahead that every track got the message before its playhead reaches it
+    int64_t next_dsp_switch_sample()
+    {
+        int64_t playhead = playhead_sample.load(std::memory_order_relaxed);
+        if (playhead == -1)
+            return -1;
+        return playhead + static_cast<int64_t>(playhead_sample_rate.load(std::memory_order_relaxed) * 0.05);
+    }
+
+    //only what changed since the last version goes out, the full list is sent to the tracks which ask for it
     void broadcastChannelList(const MuliTrack_Model& model)
     {
-        juce::ignoreUnused(model);
-        Game_Channel_Broadcast_Message out = {};
-        assert(model.game_channels.size() == model.order.size());
-        //assert(model.game_channels.size() == model.assigned_daw_track_count.size());
-        out.channel_count = static_cast<int>(model.game_channels.size());
-        for (auto i = 0; i < model.game_channels.size(); i++)
+        const std::vector<Game_Channel> &channels = model.game_channels;
+        forget_removed_dsp_states(model);
+
+        std::vector<Channel_List_Op> ops;
+        bool is_delta = channel_list_diff(sent_channel_list, channels, &ops);
+        if (is_delta && ops.empty())
+            return;
+
+        uint64_t from_version = channel_list_version;
+        channel_list_version++;
+        sent_channel_list = channels;
+        if (transport)
+        {
+            transport_publish_channel_list(transport.get(), sent_channel_list);
+        }
+
+        if (!is_delta || ops.size() >= sent_channel_list.size())
+        {
+            broadcastChannelListSnapshot();
+            return;
+        }
+        auto encoded = channel_list_ops_encode(ops);
+        auto message = juce::String("channel_list_delta ") + juce::String(channel_list_session) + " " + juce::String(from_version) + " " 
+            + juce::Base64::toBase64(encoded.data(), encoded.size());
+        juce::MessageManager::getInstance()->broadcastMessage(message);
+    }
+
+    //a channel deleted and created again has a new id, the old one would hold its dsp slot for good.
+    //also drops a state the game thread sent for a channel removed meanwhile
+    void forget_removed_dsp_states(const MuliTrack_Model& model)
+    {
+        std::lock_guard lock { dsp_mutex };
+        for (auto it = last_dsp_states.begin(); it != last_dsp_states.end();)
         {
-            auto id = model.order.at(i);
-            auto track = model.game_channels.at(id);
-            out.channels[i] = track;
+            if (multitrack_model_find_game_channel(&model, it->first) != -1)
+            {
+                ++it;
+                continue;
+            }
+            if (transport)
+                transport_remove_dsp(transport.get(), it->first);
+            it = last_dsp_states.erase(it);
         }
-        auto message = juce::String("new_track_list ") + juce::String::toHexString((void*)&out, sizeof(out), 0);
+    }
+
+    void broadcastChannelListSnapshot()
+    {
+        channel_list_snapshot_timer.stopTimer();
+        auto encoded = channel_list_encode(sent_channel_list);
+        auto message = juce::String("channel_list ") + juce::String(channel_list_session) + " " + juce::String(channel_list_version) + " " 
+            + juce::Base64::toBase64(encoded.data(), encoded.size());
         juce::MessageManager::getInstance()->broadcastMessage(message);
     }
 
     
+    //every track created or asking within the window gets the same snapshot
+    void request_channel_list_snapshot()
+    {
+        if (!channel_list_snapshot_timer.isTimerRunning())
+            channel_list_snapshot_timer.startTimer(30);
+    }
+
+    void handle_command(const Transport_Command &command);
+    //message thread
+    void open_transport();
+    void close_transport();
+    
+    //tracks in other processes only reach the host through the shared memory,
+    //the tracks in this one also broadcast, both end up in handle_command
+    std::unique_ptr<Transport> transport;
+    //what the tracks were last sent, a track newly bound to a channel gets it resent
+    std::unordered_map<uint32_t, Channel_DSP_State> last_dsp_states;
+    //guards last_dsp_states and the transport within this host, the game thread and the message thread both publish.
+    //another host on the segment doesn't write to it, see Transport::is_owner
+    std::mutex dsp_mutex;
+    Timer transport_timer;
+    int transport_open_countdown = 0;
+    //tracks keep the session and version they last applied, a restarted host starts a new session
+    uint32_t channel_list_session = random_uint();
+    uint64_t channel_list_version = 0;
+    std::vector<Game_Channel> sent_channel_list;
+    Timer channel_list_snapshot_timer;
+    //written by the audio thread, -1 when the DAW isn't playing
+    std::atomic<int64_t> playhead_sample { -1 };
+    std::atomic<double> playhead_sample_rate { 44100.0 };
+    //the mix bus the host sits on, metered on the audio thread
+    Bus_Meter bus_meter = {};
+    std::atomic<uint32_t> bus_meter_sequence { 0 };
+    Level_Meter_Values bus_meter_values = { -100.0f, -100.0f, -100.0f };
     Application app;
     private:
     
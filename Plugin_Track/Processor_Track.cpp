@@ -11,6 +11,8 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 
 #include "../shared/shared.h"
+#include "../shared/transport.h"
+#include "../shared/audio.h"
 #include "Processor_Track.h"
 #include "PluginEditor_Track.h"
 
@@ -29,19 +31,82 @@ ProcessorTrack::ProcessorTrack()
 ,
     daw_channel_id { random_uint() },
     name { daw_channel_id },
-    gain_db { 0.0f },
     minFrequency { 20 },
     maxFrequency { 20000 }
 {
     juce::MessageManager::getInstance()->registerBroadcastListener(this);
-    juce::MessageManager::getInstance()->broadcastMessage(juce::String("create ") + juce::String(daw_channel_id));
+    attach_transport();
+    transport_timer.callback = [this] (juce::int64) {
+        if (transport && transport_is_retired(transport.get()))
+            detach_transport();
+        //no host yet, or it went away : looked for again every half second, the broadcast works in the meantime
+        if (!transport && --transport_attach_countdown <= 0)
+        {
+            transport_attach_countdown = 10;
+            if (attach_transport())
+            {
+                //the host behind the segment may never have heard of this track
+                send_command({ .type = Transport_Command_Create, .daw_channel_id = daw_channel_id }, juce::String("create ") + juce::String(daw_channel_id));
+                if (game_channel_id != -1)
+                    broadcast_selected_game_channel();
+            }
+        }
+        if (!transport)
+            return;
+        //the pool may have been full, or the host reclaimed the slot while this track was stalled
+        if (meter_slot == -1 || !transport_beat_meter_slot(transport.get(), meter_slot, daw_channel_id))
+            meter_slot = transport_claim_meter_slot(transport.get(), daw_channel_id);
+        if (transport_read_channel_list(transport.get(), &channel_list_version, &game_channels))
+        {
+            if (auto *editor = (EditorTrack*)getActiveEditor())
+            {
+                editor->update_track_list();
+            }
+        }
+    };
+    transport_timer.startTimer(50);
+    send_command({ .type = Transport_Command_Create, .daw_channel_id = daw_channel_id }, juce::String("create ") + juce::String(daw_channel_id));
+    if (!transport)
+        request_broadcast_list();
     //broadcastFrequencies();
 }
 
 ProcessorTrack::~ProcessorTrack()
 {
-    juce::MessageManager::getInstance()->broadcastMessage(juce::String("delete ") + juce::String(daw_channel_id));
+    transport_timer.stopTimer();
+    send_command({ .type = Transport_Command_Delete, .daw_channel_id = daw_channel_id }, juce::String("delete ") + juce::String(daw_channel_id));
     juce::MessageManager::getInstance()->deregisterBroadcastListener(this);
+    if (transport)
+    {
+        if (meter_slot != -1)
+            transport_release_meter_slot(transport.get(), meter_slot, daw_channel_id);
+        transport_close(transport.get());
+    }
+    for (auto &retired : retired_transports)
+        transport_close(retired.get());
+}
+
+bool ProcessorTrack::attach_transport()
+{
+    transport = transport_open(Transport_Role_Track);
+    if (!transport)
+        return false;
+    meter_slot = transport_claim_meter_slot(transport.get(), daw_channel_id);
+    //a new segment has its own versions
+    channel_list_version = 0;
+    audio_transport.store(transport.get(), std::memory_order_release);
+    return true;
+}
+
+void ProcessorTrack::detach_transport()
+{
+    audio_transport.store(nullptr, std::memory_order_release);
+    meter_slot = -1;
+    //the broadcast list is listened to again until the next segment
+    channel_list_version = 0;
+    request_broadcast_list();
+    //the audio thread may still be reading it, it stays mapped until the track goes away
+    retired_transports.push_back(std::move(transport));
 }
 
 //==============================================================================
@@ -112,9 +177,13 @@ void ProcessorTrack::changeProgramName(int index, const juce::String& newName)
 //==============================================================================
 void ProcessorTrack::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
-    juce::ignoreUnused(sampleRate, samplesPerBlock);
+    sample_rate = sampleRate;
+    auto channel_count = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    channel_dsp_prepare_realtime(&dsp_chain, { sampleRate, checked_cast<uint32_t>(samplesPerBlock), checked_cast<uint32_t>(channel_count) }, applied_dsp);
+    level_window_length = std::max(1, static_cast<int>(sampleRate * 0.05));
+    level_window_position = 0;
+    level_window_peak = 0.0f;
+    level_window_sum_of_squares = 0.0;
 }
 
 void ProcessorTrack::releaseResources()
@@ -155,8 +224,73 @@ void ProcessorTrack::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBu
     juce::ScopedNoDenormals noDenormals;
     //auto totalNumInputChannels = getTotalNumInputChannels();
     //auto totalNumOutputChannels = getTotalNumOutputChannels();
-    auto gain = juce::Decibels::decibelsToGain(static_cast<float>(gain_db));
-    buffer.applyGain(gain);
+    //the shared memory has it when the host runs in another process, the broadcast otherwise
+    Scheduled_DSP_State latest;
+    int64_t selected_game_channel_id = audio_game_channel_id.load(std::memory_order_relaxed);
+    Transport *shared = audio_transport.load(std::memory_order_acquire);
+    bool is_from_transport = shared && selected_game_channel_id != -1
+        && transport_read_dsp(shared, checked_cast<uint32_t>(selected_game_channel_id), &dsp_slot_hint, &latest);
+    if (!is_from_transport && !seqlock_read(&published_dsp_sequence, &published_dsp, &latest))
+        latest = { .dsp = applied_dsp, .apply_at_sample = -1 };
+
+    //every track switches at the sample the host picked, so an A/B comparison flips in the same spot on all of them
+    int sample_count = buffer.getNumSamples();
+    int switch_offset = sample_count;
+    if (!channel_dsp_equal(latest.dsp, applied_dsp))
+    {
+        int64_t block_start = playhead_sample_position(getPlayHead());
+        int64_t apply_at = latest.apply_at_sample;
+        //stopped, late, or the playhead jumped back (loop, seek) : right away
+        bool is_now = apply_at == -1 || block_start == -1 || apply_at <= block_start
+            || apply_at - block_start > static_cast<int64_t>(sample_rate);
+        if (is_now)
+            switch_offset = 0;
+        else if (apply_at - block_start < sample_count)
+            switch_offset = static_cast<int>(apply_at - block_start);
+    }
+
+    juce::dsp::AudioBlock<float> block(buffer);
+    if (switch_offset > 0)
+    {
+        auto before = block.getSubBlock(0, static_cast<size_t>(switch_offset));
+        juce::dsp::ProcessContextReplacing<float> context(before);
+        dsp_chain.process(context);
+    }
+    if (switch_offset < sample_count)
+    {
+        applied_dsp = latest.dsp;
+        //the host computed them for every track on the channel, unless it runs at another rate
+        if (latest.params.sample_rate == sample_rate)
+            channel_dsp_apply_params(&dsp_chain, latest.params);
+        else
+            channel_dsp_update_chain_realtime(&dsp_chain, applied_dsp, sample_rate);
+        auto after = block.getSubBlock(static_cast<size_t>(switch_offset));
+        juce::dsp::ProcessContextReplacing<float> context(after);
+        dsp_chain.process(context);
+    }
+
+    //after the chain, what this track actually sends to the DAW
+    int32_t level_slot = meter_slot.load(std::memory_order_relaxed);
+    if (shared && level_slot != -1)
+    {
+        int channel_count = buffer.getNumChannels();
+        for (int channel = 0; channel < channel_count; channel++)
+        {
+            level_window_peak = std::max(level_window_peak, audio_peak(buffer.getReadPointer(channel), sample_count));
+            level_window_sum_of_squares += audio_sum_of_squares(buffer.getReadPointer(channel), sample_count);
+        }
+        level_window_position += sample_count;
+        if (level_window_position >= level_window_length)
+        {
+            double mean_square = level_window_sum_of_squares / (double(level_window_position) * std::max(1, channel_count));
+            transport_publish_track_level(shared, level_slot,
+                                          juce::Decibels::gainToDecibels(level_window_peak),
+                                          juce::Decibels::gainToDecibels(static_cast<float>(std::sqrt(mean_square))));
+            level_window_position = 0;
+            level_window_peak = 0.0f;
+            level_window_sum_of_squares = 0.0;
+        }
+    }
 }
 
 //==============================================================================
@@ -193,7 +327,7 @@ void ProcessorTrack::setStateInformation(const void* data, int sizeInBytes)
         char in_message[sizeof(out_message) / sizeof(*out_message)] = {};
         in.read(in_message, sizeof(in_message));
 
-        game_channel_id = in.readInt();
+        game_channel_id = in.readInt64();
         broadcast_selected_game_channel();
     }
 }
@@ -201,7 +335,9 @@ void ProcessorTrack::setStateInformation(const void* data, int sizeInBytes)
 void ProcessorTrack::updateTrackProperties(const TrackProperties& properties)
 {
     name = properties.name;
-    juce::MessageManager::getInstance()->broadcastMessage(juce::String("name_from_track ") + juce::String(daw_channel_id) + juce::String(" ") + name);
+    Transport_Command command = { .type = Transport_Command_Rename, .daw_channel_id = daw_channel_id };
+    name.copyToUTF8(command.name, sizeof(command.name));
+    send_command(command, juce::String("name_from_track ") + juce::String(daw_channel_id) + juce::String(" ") + name);
     if (auto *editor = (EditorTrack*)getActiveEditor())
     {
         //editor->renameTrack(name);
@@ -211,24 +347,30 @@ void ProcessorTrack::updateTrackProperties(const TrackProperties& properties)
 
 void ProcessorTrack::actionListenerCallback(const juce::String& message)
 {
+    //checked before tokenizing, the batch holds the state of every changed channel
+    if (message.startsWith("dsp_batch "))
+    {
+        Scheduled_DSP_State state;
+        if (channel_list_version == 0 && game_channel_id != -1
+            && dsp_batch_find(message, checked_cast<uint32_t>(game_channel_id), &state))
+        {
+            seqlock_write(&published_dsp_sequence, &published_dsp, state);
+        }
+        return;
+    }
+
+    if (message.startsWith("channel_list"))
+    {
+        if (channel_list_version == 0)
+            receive_channel_list(message);
+        return;
+    }
+
     juce::StringArray tokens = juce::StringArray::fromTokens(message, " ", "\"");
     
     assert(tokens.size() >= 2);
     
-    if(tokens[0] == "dsp")
-    {
-        int message_id = tokens[1].getIntValue();
-        if(message_id != game_channel_id)
-            return;
-        auto blob = juce::MemoryBlock{};
-        blob.loadFromHexString(tokens[2]);
-        size_t blob_size = blob.getSize();
-        size_t dsp_state_size = sizeof(Channel_DSP_State);
-        assert(blob_size == dsp_state_size);
-        Channel_DSP_State state = *(Channel_DSP_State*)blob.getData();
-        gain_db = state.gain_db;
-    }
-    else if(tokens[0] == "name_from_ui")
+    if(tokens[0] == "name_from_ui")
     {
         uint32_t message_id = checked_cast<uint32_t>(tokens[1].getLargeIntValue());
         if(message_id != daw_channel_id)
@@ -239,32 +381,77 @@ void ProcessorTrack::actionListenerCallback(const juce::String& message)
             //editor->renameTrack(name);
         }
     }
-    else if (tokens[0] == "new_track_list")
+}
+
+//the host gathers the requests of a settle window into one snapshot
+void ProcessorTrack::request_broadcast_list()
+{
+    if (is_broadcast_list_requested)
+        return;
+    juce::MessageManager::getInstance()->broadcastMessage(juce::String("channel_list_request ") + juce::String(daw_channel_id));
+    is_broadcast_list_requested = true;
+}
+
+void ProcessorTrack::receive_channel_list(const juce::String& message)
+{
+    //only the header is tokenized, the payload can be long
+    juce::StringArray tokens = juce::StringArray::fromTokens(message.substring(0, 64), " ", "");
+    if (tokens.size() < 3)
+        return;
+    uint32_t session = checked_cast<uint32_t>(tokens[1].getLargeIntValue());
+    uint64_t version = checked_cast<uint64_t>(tokens[2].getLargeIntValue());
+    auto payload = message.substring(tokens[0].length() + tokens[1].length() + tokens[2].length() + 3);
+
+    if (tokens[0] == "channel_list")
+    {
+        if (session == broadcast_list_session && version <= broadcast_list_version)
+            return;
+        juce::MemoryOutputStream blob;
+        if (!juce::Base64::convertFromBase64(blob, payload)
+            || !channel_list_decode(static_cast<const uint8_t*>(blob.getData()), blob.getDataSize(), &game_channels))
+        {
+            jassertfalse;
+            return;
+        }
+        broadcast_list_session = session;
+        broadcast_list_version = version;
+        is_broadcast_list_requested = false;
+    }
+    else if (tokens[0] == "channel_list_delta")
     {
-        auto blob = juce::MemoryBlock{};
-        blob.loadFromHexString(tokens[1]);
-        size_t blob_size = blob.getSize();
-        size_t track_list_size = sizeof(Game_Channel_Broadcast_Message);
-        assert(blob_size == track_list_size);
-        Game_Channel_Broadcast_Message in = *(Game_Channel_Broadcast_Message*)blob.getData();
-        
-        game_channels.clear();
-        for (auto i = 0; i < in.channel_count; i++)
+        //the version is the one the delta applies to
+        if (session == broadcast_list_session && version < broadcast_list_version)
+            return;
+        bool is_applied = false;
+        if (session == broadcast_list_session && version == broadcast_list_version)
         {
-            game_channels.push_back(in.channels[i]);
+            juce::MemoryOutputStream blob;
+            std::vector<Channel_List_Op> ops;
+            is_applied = juce::Base64::convertFromBase64(blob, payload)
+                && channel_list_ops_decode(static_cast<const uint8_t*>(blob.getData()), blob.getDataSize(), &ops)
+                && channel_list_apply(&game_channels, ops);
         }
-        assert(game_channels.size() == in.channel_count);
-
-        if (auto *editor = (EditorTrack*)getActiveEditor())
+        if (!is_applied)
         {
-            editor->update_track_list();
+            request_broadcast_list();
+            return;
         }
+        broadcast_list_version = version + 1;
+    }
+    else return;
+
+    if (auto *editor = (EditorTrack*)getActiveEditor())
+    {
+        editor->update_track_list();
     }
 }
 //==============================================================================
 // This creates new instances of the plugin..
+//the bench builds the host and the tracks into one executable
+#if ! MIXTRAINER_HEADLESS
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new ProcessorTrack();
 }
+#endif
 
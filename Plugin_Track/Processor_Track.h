@@ -23,6 +23,9 @@ class ProcessorTrack : public juce::AudioProcessor, public juce::ActionListener
     public:
     // Inherited via ActionListener
     void actionListenerCallback(const juce::String& message) override;
+    void receive_channel_list(const juce::String& message);
+    //only the tracks which have neither the shared memory nor a broadcast list ask for a snapshot
+    void request_broadcast_list();
     //==============================================================================
     ProcessorTrack();
     ~ProcessorTrack() override;
@@ -85,10 +88,24 @@ class ProcessorTrack : public juce::AudioProcessor, public juce::ActionListener
     
     void broadcast_selected_game_channel()
     {
+        audio_game_channel_id.store(game_channel_id);
         juce::String message = 
             juce::String("select_game_channel ") + 
             juce::String(daw_channel_id) + " " + 
             juce::String(game_channel_id);
+        Transport_Command command = {
+            .type = Transport_Command_Select_Game_Channel,
+            .daw_channel_id = daw_channel_id,
+            .game_channel_id = game_channel_id
+        };
+        send_command(command, message);
+    }
+
+    //through the shared memory when there is one, the broadcast only reaches a host in this process
+    void send_command(const Transport_Command &command, const juce::String &message)
+    {
+        if (transport && transport_push_command(transport.get(), command))
+            return;
         juce::MessageManager::getInstance()->broadcastMessage(message);
     }
     //==============================================================================
@@ -96,9 +113,42 @@ class ProcessorTrack : public juce::AudioProcessor, public juce::ActionListener
     int64_t game_channel_id = -1;
     uint32_t daw_channel_id;
     juce::String name;
-    double gain_db;
     float minFrequency;
     float maxFrequency;
+
+    //message thread, false when no host created the segment yet
+    bool attach_transport();
+    void detach_transport();
+
+    //message thread
+    std::unique_ptr<Transport> transport;
+    //the same one, for the audio thread. the segments retired by a host stay mapped until the track goes away
+    std::atomic<Transport*> audio_transport { nullptr };
+    std::vector<std::unique_ptr<Transport>> retired_transports;
+    Timer transport_timer;
+    int transport_attach_countdown = 0;
+    //0 until the host published through the shared memory, its broadcasts are ignored afterwards
+    uint64_t channel_list_version = 0;
+    std::atomic<int64_t> audio_game_channel_id { -1 };
+    uint32_t dsp_slot_hint = transport_dsp_slot_count;
+
+    //written by the message thread when the state comes from a broadcast, read by the audio thread
+    std::atomic<uint32_t> published_dsp_sequence { 0 };
+    Scheduled_DSP_State published_dsp = { .dsp = ChannelDSP_on(), .apply_at_sample = -1 };
+    //audio thread only
+    Channel_DSP_Chain dsp_chain;
+    Channel_DSP_State applied_dsp = ChannelDSP_on();
+    double sample_rate = 44100.0;
+    //the level read by the host's meters, sent every 50 ms
+    std::atomic<int32_t> meter_slot { -1 };
+    int level_window_length = 2205;
+    int level_window_position = 0;
+    float level_window_peak = 0.0f;
+    double level_window_sum_of_squares = 0.0;
+    //the broadcast list, versioned by the host
+    uint32_t broadcast_list_session = 0;
+    uint64_t broadcast_list_version = 0;
+    bool is_broadcast_list_requested = false;
     private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorTrack)
 };
@@ -7,6 +7,7 @@
 #include "../Game/Compressor_Game.h"
 #include "../Game/Compressor_Game_UI.h"
 #include "../Game/Frequency_Game_UI.h"
+#include "Persistence.h"
 #include "Application_Standalone.h"
 #include "Standalone_UI.h"
 
@@ -57,6 +58,7 @@ bool insert_file(Audio_File_List *audio_file_list, juce::File file, juce::AudioF
         return false;
 
     Audio_File new_audio_file = {
+        .is_valid = true,
         .file = file,
         .last_modification_time = file.getLastModificationTime(),
         .title = file.getFileNameWithoutExtension().toStdString(),
@@ -68,6 +70,7 @@ bool insert_file(Audio_File_List *audio_file_list, juce::File file, juce::AudioF
     audio_file_list->files.emplace(hash, std::move(new_audio_file));
     audio_file_list->selected.emplace(hash, false);
     audio_file_list->order.emplace_back(hash);
+    audio_file_list->generation++;
     //TODO assert sizes, assert emplaces
     return true;
 }
@@ -91,6 +94,7 @@ void remove_files(Audio_File_List *audio_file_list, std::vector<int> indices)
             audio_file_list->order.erase(audio_file_list->order.begin() + idx);
         }
     }
+    audio_file_list->generation++;
 }
 
     
@@ -101,8 +105,9 @@ std::vector<Audio_File> generate_list_of_selected_files(Audio_File_List *audio_f
     std::vector<Audio_File> selected_files;
     for (uint64_t hash : audio_file_list->order)
     {
-        if(audio_file_list->selected.at(hash))
-            selected_files.push_back(audio_file_list->files.at(hash));
+        const auto &audio_file = audio_file_list->files.at(hash);
+        if(audio_file_list->selected.at(hash) && audio_file.is_valid)
+            selected_files.push_back(audio_file);
     }
     return selected_files;
 }
@@ -133,10 +138,23 @@ std::vector<std::string> generate_titles(Audio_File_List *audio_file_list)
     return titles;
 }
 
+std::vector<bool> generate_validity(Audio_File_List *audio_file_list)
+{
+    std::vector<bool> validity{};
+    validity.reserve(audio_file_list->order.size());
+    for (uint64_t hash : audio_file_list->order)
+        validity.push_back(audio_file_list->files.at(hash).is_valid);
+    return validity;
+}
+
 static const juce::Identifier id_results_root = "results_history";
 static const juce::Identifier id_result = "result";
 static const juce::Identifier id_result_score = "score";
 static const juce::Identifier id_result_timestamp = "timestamp";
+static const juce::Identifier id_result_question_count = "question_count";
+static const juce::Identifier id_result_mean_distance = "mean_distance";
+static const juce::Identifier id_result_mean_response_time_ms = "mean_response_time_ms";
+static const juce::Identifier id_results_last_sequence = "last_sequence";
 
 static const juce::Identifier id_files_root = "audio_files";
 static const juce::Identifier id_file = "file";
@@ -184,10 +202,9 @@ std::vector<Audio_File> audio_file_list_deserialize(std::string xml_string)
         if(node.getType() != id_file)
             continue;
 
+        //the file is trusted until the validator says otherwise, touching the disk here would block startup
         juce::String file_name = node.getProperty(id_file_name);
         auto file = juce::File{ file_name };
-        if(!file.existsAsFile())
-            continue;
         auto loop_bounds_ms = deserialize_vector<int64_t>(node.getProperty(id_file_loop_bounds_ms, ""));
         if(loop_bounds_ms.size() != 2)
             continue;
@@ -196,6 +213,7 @@ std::vector<Audio_File> audio_file_list_deserialize(std::string xml_string)
             continue;
         int64_t modification_time = (juce::int64)node.getProperty(id_file_last_modification_time, 0);
         Audio_File audio_file = {
+            .is_valid = true,
             .file = file,
             .last_modification_time = juce::Time(modification_time),
             .title = node.getProperty(id_file_title, "").toString().toStdString(),
@@ -209,6 +227,180 @@ std::vector<Audio_File> audio_file_list_deserialize(std::string xml_string)
     return audio_files;
 }
 
+static void audio_file_validator_loop(Audio_File_Validator *validator, std::vector<Audio_File> files, juce::AudioFormatManager *format_manager)
+{
+    for (const auto &audio_file : files)
+    {
+        if (validator->should_exit)
+            return;
+        Audio_File_Validation_Result result = {
+            .hash = audio_file.hash,
+            .is_valid = audio_file.file.existsAsFile(),
+            .was_rescanned = false
+        };
+        if (result.is_valid)
+        {
+            auto modification_time = audio_file.file.getLastModificationTime();
+            if (modification_time.toMilliseconds() > audio_file.last_modification_time.toMilliseconds())
+            {
+                result.rescanned_file = audio_file_scan_length_and_max(audio_file, format_manager);
+                result.rescanned_file.last_modification_time = modification_time;
+                result.was_rescanned = true;
+            }
+        }
+        std::lock_guard lock { validator->mutex };
+        validator->results.push_back(std::move(result));
+    }
+    validator->is_done = true;
+}
+
+std::unique_ptr<Audio_File_Validator> audio_file_validator_start(std::vector<Audio_File> files, juce::AudioFormatManager *format_manager)
+{
+    auto validator = std::make_unique<Audio_File_Validator>();
+    validator->should_exit = false;
+    validator->is_done = false;
+    validator->thread = std::thread(audio_file_validator_loop, validator.get(), std::move(files), format_manager);
+    return validator;
+}
+
+std::vector<Audio_File_Validation_Result> audio_file_validator_pop_results(Audio_File_Validator *validator)
+{
+    std::vector<Audio_File_Validation_Result> results{};
+    std::lock_guard lock { validator->mutex };
+    std::swap(results, validator->results);
+    return results;
+}
+
+void audio_file_validator_stop(Audio_File_Validator *validator)
+{
+    validator->should_exit = true;
+    validator->thread.join();
+}
+
+static std::string frequency_game_results_serialize(const std::vector<FrequencyGame_Results> &results_history, int64_t last_sequence)
+{
+    juce::ValueTree root_node { id_results_root, {
+        { id_results_last_sequence, juce::int64(last_sequence) }
+    }};
+    for (const FrequencyGame_Results& result : results_history)
+    {
+        juce::ValueTree node = { id_result, {
+            { id_result_score,  result.score },
+            { id_result_question_count, result.question_count },
+            { id_result_mean_distance, result.mean_distance },
+            { id_result_mean_response_time_ms, result.mean_response_time_ms },
+            { id_result_timestamp, juce::int64(result.timestamp) }
+        } };
+        root_node.addChild(node, -1, nullptr);
+    }
+    return root_node.toXmlString().toStdString();
+}
+
+static std::string compressor_game_results_serialize(const std::vector<CompressorGame_Results> &results_history, int64_t last_sequence)
+{
+    juce::ValueTree root_node { id_results_root, {
+        { id_results_last_sequence, juce::int64(last_sequence) }
+    }};
+    for (const CompressorGame_Results& result : results_history)
+    {
+        juce::ValueTree node = { id_result, {
+            { id_result_score,  result.score },
+            { id_result_question_count, result.question_count },
+            { id_result_mean_distance, result.mean_distance },
+            { id_result_mean_response_time_ms, result.mean_response_time_ms },
+            { id_result_timestamp, juce::int64(result.timestamp) }
+        } };
+        root_node.addChild(node, -1, nullptr);
+    }
+    return root_node.toXmlString().toStdString();
+}
+
+static void frequency_game_stats_add(Stats *stats, uint32_t target_frequency, uint32_t answer_frequency, int32_t points, int64_t response_time_ms)
+{
+    bool is_answered = answer_frequency != 0;
+    float error_octaves = is_answered ? std::abs(std::log2(float(answer_frequency) / float(target_frequency))) : 0.0f;
+    stats_add_result(stats, stats_octave_bin(target_frequency), points > 0, is_answered, error_octaves, float(response_time_ms));
+}
+
+static void compressor_game_stats_add(Stats *stats, uint32_t distance, int64_t response_time_ms)
+{
+    stats_add_result(stats, 0, distance == 0, true, float(distance), float(response_time_ms));
+}
+
+//the same rule for the live stats and for the rebuild : a question starts a session when its session id differs from the previous question's.
+//a session without any question doesn't count
+static bool stats_is_new_session(const std::vector<int64_t> &question_sessions, size_t row, int64_t session)
+{
+    return row == 0 || question_sessions[row - 1] != session;
+}
+
+//the rows written before the session ids were kept have 0, they are attributed to the first session that ended after them
+static std::vector<size_t> questions_session_starts(const std::vector<int64_t> &question_sessions, 
+                                                    const std::vector<int64_t> &question_timestamps, 
+                                                    const std::vector<int64_t> &session_end_timestamps)
+{
+    std::vector<size_t> session_starts{};
+    size_t session_idx = 0;
+    for (size_t row = 0; row < question_timestamps.size(); row++)
+    {
+        int64_t session = question_sessions[row];
+        bool is_new_session = stats_is_new_session(question_sessions, row, session);
+        if (session == 0)
+        {
+            while (session_idx < session_end_timestamps.size() && session_end_timestamps[session_idx] < question_timestamps[row])
+            {
+                session_idx++;
+                is_new_session = true;
+            }
+        }
+        if (is_new_session)
+            session_starts.push_back(row);
+    }
+    return session_starts;
+}
+
+static Stats frequency_game_stats_build(const Frequency_Question_Columns &questions, const std::vector<FrequencyGame_Results> &results_history)
+{
+    std::vector<int64_t> session_ends{};
+    for (const auto &result : results_history)
+        session_ends.push_back(result.timestamp);
+    auto session_starts = questions_session_starts(questions.session, questions.timestamp, session_ends);
+
+    Stats stats = stats_init(stats_octave_bin_names());
+    size_t next_session = 0;
+    for (size_t row = 0; row < questions.sequence.size(); row++)
+    {
+        if (next_session < session_starts.size() && session_starts[next_session] == row)
+        {
+            stats_begin_session(&stats);
+            next_session++;
+        }
+        frequency_game_stats_add(&stats, questions.target_frequency[row], questions.answer_frequency[row], questions.points[row], questions.response_time_ms[row]);
+    }
+    return stats;
+}
+
+static Stats compressor_game_stats_build(const Compressor_Question_Columns &questions, const std::vector<CompressorGame_Results> &results_history)
+{
+    std::vector<int64_t> session_ends{};
+    for (const auto &result : results_history)
+        session_ends.push_back(result.timestamp);
+    auto session_starts = questions_session_starts(questions.session, questions.timestamp, session_ends);
+
+    Stats stats = stats_init({ "All parameters" });
+    size_t next_session = 0;
+    for (size_t row = 0; row < questions.sequence.size(); row++)
+    {
+        if (next_session < session_starts.size() && session_starts[next_session] == row)
+        {
+            stats_begin_session(&stats);
+            next_session++;
+        }
+        compressor_game_stats_add(&stats, questions.distance[row], questions.response_time_ms[row]);
+    }
+    return stats;
+}
+
 Application_Standalone::Application_Standalone(juce::AudioFormatManager *formatManager, Main_Component *mainComponent)
 :   player(formatManager),
     main_component(mainComponent)
@@ -222,7 +414,8 @@ Application_Standalone::Application_Standalone(juce::AudioFormatManager *formatM
 
     juce::File app_data = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory);
     DBG(app_data.getFullPathName());
-    auto store_directory = app_data.getChildFile("MixTrainer");
+    store_directory = app_data.getChildFile("MixTrainer");
+    store_directory.createDirectory();
 
     auto get_file_from_appdata = [&] (juce::String file_name) -> std::unique_ptr<juce::FileInputStream>
     {
@@ -258,13 +451,11 @@ Application_Standalone::Application_Standalone(juce::AudioFormatManager *formatM
             audio_file_list.selected.emplace(hash, false);
             audio_file_list.order.emplace_back(hash);
         }
-        for (auto& [hash, audio_file] : audio_file_list.files)
-        {
-            if (audio_file.file.getLastModificationTime().toMilliseconds() > audio_file.last_modification_time.toMilliseconds())
-            {
-                audio_file = audio_file_scan_length_and_max(audio_file, formatManager);
-            }
-        }
+        audio_file_validator = audio_file_validator_start(std::move(file_vec), formatManager);
+        audio_file_validation_timer.callback = [this] (juce::int64) {
+            apply_audio_file_validation_results();
+        };
+        audio_file_validation_timer.startTimer(100);
     }();
 
     //load frequency config list
@@ -276,6 +467,7 @@ Application_Standalone::Application_Standalone(juce::AudioFormatManager *formatM
     }();
     
     //load previous results
+    int64_t frequency_game_results_last_sequence = 0;
     [&] {
         auto stream = get_file_from_appdata("frequency_game_results.xml");
         if (!stream) return;
@@ -283,13 +475,18 @@ Application_Standalone::Application_Standalone(juce::AudioFormatManager *formatM
         juce::ValueTree root_node = juce::ValueTree::fromXml(xml_string);
         if(root_node.getType() != id_results_root)
             return;
+        frequency_game_results_last_sequence = (juce::int64)root_node.getProperty(id_results_last_sequence, 0);
         for (uint32_t i = 0; i < checked_cast<uint32_t>(root_node.getNumChildren()); i++)
         {
             juce::ValueTree node = root_node.getChild(i);
             if(node.getType() != id_result)
                 continue;
             FrequencyGame_Results result = {
-                .score = node.getProperty(id_result_score, "")
+                .score = node.getProperty(id_result_score, ""),
+                .question_count = node.getProperty(id_result_question_count, 0),
+                .mean_distance = node.getProperty(id_result_mean_distance, 0.0f),
+                .mean_response_time_ms = node.getProperty(id_result_mean_response_time_ms, 0.0f),
+                .timestamp = (juce::int64)node.getProperty(id_result_timestamp, 0)
             };
             frequency_game_results_history.push_back(result);
         }
@@ -305,6 +502,7 @@ Application_Standalone::Application_Standalone(juce::AudioFormatManager *formatM
     
 
     //load previous results
+    int64_t compressor_game_results_last_sequence = 0;
     [&] {
         auto stream = get_file_from_appdata("compressor_game_results.xml");
         if (!stream) return;
@@ -312,117 +510,259 @@ Application_Standalone::Application_Standalone(juce::AudioFormatManager *formatM
         juce::ValueTree root_node = juce::ValueTree::fromXml(xml_string);
         if(root_node.getType() != id_results_root)
             return;
+        compressor_game_results_last_sequence = (juce::int64)root_node.getProperty(id_results_last_sequence, 0);
         for (uint32_t i = 0; i < checked_cast<uint32_t>(root_node.getNumChildren()); i++)
         {
             juce::ValueTree node = root_node.getChild(i);
             if(node.getType() != id_result)
                 continue;
             CompressorGame_Results result = {
-                .score = node.getProperty(id_result_score, "")
+                .score = node.getProperty(id_result_score, ""),
+                .question_count = node.getProperty(id_result_question_count, 0),
+                .mean_distance = node.getProperty(id_result_mean_distance, 0.0f),
+                .mean_response_time_ms = node.getProperty(id_result_mean_response_time_ms, 0.0f),
+                .timestamp = (juce::int64)node.getProperty(id_result_timestamp, 0)
             };
             compressor_game_results_history.push_back(result);
         }
     }();
 
+    //load per question results
+    auto frequency_questions_directory = store_directory.getChildFile("frequency_questions");
+    auto compressor_questions_directory = store_directory.getChildFile("compressor_questions");
+    frequency_questions = frequency_question_columns_load(frequency_questions_directory);
+    compressor_questions = compressor_question_columns_load(compressor_questions_directory);
+    int64_t frequency_questions_last_sequence = frequency_questions.sequence.empty() ? 0 : frequency_questions.sequence.back();
+    int64_t compressor_questions_last_sequence = compressor_questions.sequence.empty() ? 0 : compressor_questions.sequence.back();
+
+    //replay the journal on top of the snapshots, then compact it into them
+    //each snapshot remembers the last record it contains, so a crash in the middle of this is harmless
+    [&] {
+        auto journal_file = store_directory.getChildFile("results.journal");
+        auto records = results_journal_read(journal_file);
+        int64_t last_sequence = std::max({
+            frequency_game_results_last_sequence, compressor_game_results_last_sequence,
+            frequency_questions_last_sequence, compressor_questions_last_sequence
+        });
+        Frequency_Question_Columns new_frequency_questions = {};
+        Compressor_Question_Columns new_compressor_questions = {};
+        for (const auto& record : records)
+        {
+            last_sequence = std::max(last_sequence, record.sequence);
+            switch (record.type)
+            {
+                case Journal_Record_Frequency_Game_Result :
+                {
+                    if (record.sequence <= frequency_game_results_last_sequence)
+                        continue;
+                    frequency_game_results_history.push_back({
+                        .score = record.game_result.score,
+                        .question_count = record.game_result.question_count,
+                        .mean_distance = record.game_result.mean_distance,
+                        .mean_response_time_ms = record.game_result.mean_response_time_ms,
+                        .timestamp = record.game_result.timestamp
+                    });
+                } break;
+                case Journal_Record_Compressor_Game_Result :
+                {
+                    if (record.sequence <= compressor_game_results_last_sequence)
+                        continue;
+                    compressor_game_results_history.push_back({
+                        .score = record.game_result.score,
+                        .question_count = record.game_result.question_count,
+                        .mean_distance = record.game_result.mean_distance,
+                        .mean_response_time_ms = record.game_result.mean_response_time_ms,
+                        .timestamp = record.game_result.timestamp
+                    });
+                } break;
+                case Journal_Record_Frequency_Question :
+                {
+                    if (record.sequence <= frequency_questions_last_sequence)
+                        continue;
+                    const auto &question = record.frequency_question;
+                    frequency_question_columns_push(&frequency_questions, record.sequence, question.session, question.result);
+                    frequency_question_columns_push(&new_frequency_questions, record.sequence, question.session, question.result);
+                } break;
+                case Journal_Record_Compressor_Question :
+                {
+                    if (record.sequence <= compressor_questions_last_sequence)
+                        continue;
+                    const auto &question = record.compressor_question;
+                    compressor_question_columns_push(&compressor_questions, record.sequence, question.session, question.result);
+                    compressor_question_columns_push(&new_compressor_questions, record.sequence, question.session, question.result);
+                } break;
+                case Journal_Record_None :
+                default :
+                {
+                    jassertfalse;
+                } break;
+            }
+        }
+        if (!records.empty())
+        {
+            bool success = write_file_atomically(store_directory.getChildFile("frequency_game_results.xml"), 
+                                                 frequency_game_results_serialize(frequency_game_results_history, last_sequence));
+            success &= write_file_atomically(store_directory.getChildFile("compressor_game_results.xml"), 
+                                             compressor_game_results_serialize(compressor_game_results_history, last_sequence));
+            success &= frequency_question_columns_append(frequency_questions_directory, new_frequency_questions);
+            success &= compressor_question_columns_append(compressor_questions_directory, new_compressor_questions);
+            //the journal is the only copy until the snapshots are durable, on any failure it is kept and replayed next time
+            success = success && sync_directory(store_directory)
+                && sync_directory(frequency_questions_directory) && sync_directory(compressor_questions_directory);
+            if (success)
+                success = journal_file.deleteFile();
+            if (!success)
+                DBG("results journal kept, its compaction failed");
+        }
+        results_last_sequence = last_sequence;
+        results_journal = results_journal_open(journal_file, last_sequence + 1);
+    }();
+
     if (frequency_game_configs.empty())
     {
         frequency_game_configs = { frequency_game_config_default("Default") };
+        dirty_flags |= autosave_flag(Autosave_Frequency_Game_Configs);
     }
     if (compressor_game_configs.empty())
     {
         compressor_game_configs = { compressor_game_config_default("Default") };
+        dirty_flags |= autosave_flag(Autosave_Compressor_Game_Configs);
     }
 
+    //rebuilt once here, then updated as the results come in
+    frequency_game_stats = frequency_game_stats_build(frequency_questions, frequency_game_results_history);
+    compressor_game_stats = compressor_game_stats_build(compressor_questions, compressor_game_results_history);
+
+    saved_audio_file_list_generation = audio_file_list.generation;
+    autosave = autosave_start(store_directory);
+    autosave_timer.callback = [this] (juce::int64) {
+        autosave_dirty_targets();
+    };
+    autosave_timer.startTimer(2000);
+
     to_main_menu();
 }
 
 Application_Standalone::~Application_Standalone()
 {
-    juce::File app_data = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory);
-    DBG(app_data.getFullPathName());
-    assert(app_data.exists() && app_data.isDirectory());
-    auto store_directory = app_data.getChildFile("MixTrainer");
+    autosave_timer.stopTimer();
+    audio_file_validation_timer.stopTimer();
+    if (audio_file_validator)
+        audio_file_validator_stop(audio_file_validator.get());
+
+    //results are already on disk, they only need to be flushed
+    if (results_journal)
+        results_journal_close(results_journal.get());
+    else
+        dirty_flags |= autosave_flag(Autosave_Frequency_Game_Results) | autosave_flag(Autosave_Compressor_Game_Results);
+
+    dirty_flags |= dirty_flags_on_panel_exit;
+    autosave_dirty_targets();
+    autosave_stop(autosave.get());
+}
 
-    auto get_file_stream_from_appdata = [&] (juce::String file_name) -> std::unique_ptr<juce::FileOutputStream>
+void Application_Standalone::apply_audio_file_validation_results()
+{
+    //read before popping, so that the last results can't be missed
+    bool is_done = audio_file_validator->is_done;
+    auto results = audio_file_validator_pop_results(audio_file_validator.get());
+    for (auto &result : results)
     {
-        auto file_RENAME = store_directory.getChildFile(file_name);
-        auto stream = file_RENAME.createOutputStream();
-        if (!stream->openedOk())
+        //the file may have been removed from the library in the meantime
+        auto it = audio_file_list.files.find(result.hash);
+        if (it == audio_file_list.files.end())
+            continue;
+        auto &audio_file = it->second;
+        audio_file.is_valid = result.is_valid;
+        if (result.was_rescanned)
         {
-            DBG("couldn't open %appdata%/MixTrainer/" << file_name);
-            return nullptr;
+            audio_file.last_modification_time = result.rescanned_file.last_modification_time;
+            audio_file.max_level = result.rescanned_file.max_level;
+            audio_file.loop_bounds_ms = result.rescanned_file.loop_bounds_ms;
+            audio_file.file_length_ms = result.rescanned_file.file_length_ms;
+            audio_file_list.generation++;
         }
-        stream->setPosition(0);
-        stream->truncate();
-        return stream;
-    };
-
-    //save audio file list
-    [&] {
-        std::unique_ptr<juce::FileOutputStream> stream = get_file_stream_from_appdata("audio_files.xml");
-        if (!stream) return;
-        std::string file_text = audio_file_list_serialize(&audio_file_list);
-        *stream << juce::StringRef(file_text);
-    }();
+    }
+    if (!results.empty() && audio_file_settings_panel)
+        audio_file_settings_panel->update_rows_validity();
+    if (!results.empty() && audio_file_chooser)
+        audio_file_chooser->update_next_button();
 
-    //save frequency config list
-    [&] {
-        auto stream = get_file_stream_from_appdata("frequency_game_configs.xml");
-        std::string file_text = frequency_game_serlialize(&frequency_game_configs);
-        *stream << juce::StringRef(file_text);
-    }();
+    if (is_done)
+        audio_file_validation_timer.stopTimer();
+}
 
-    
-    //save frequency results
-    [&] {
-        auto stream = get_file_stream_from_appdata("frequency_game_results.xml");
-        if (!stream) return;
-        juce::ValueTree root_node { id_results_root };
-        for (const FrequencyGame_Results& result : frequency_game_results_history)
-        {
-            juce::ValueTree node = { id_result, {
-                { id_result_score,  result.score }
-            } };
-            root_node.addChild(node, -1, nullptr);
-        }
-        auto xml_string = root_node.toXmlString();
-        *stream << xml_string;
-    }();
+//snapshots are copied here, serialization and writing happen on the autosave thread
+void Application_Standalone::autosave_dirty_targets()
+{
+    if (audio_file_list.generation != saved_audio_file_list_generation)
+    {
+        dirty_flags |= autosave_flag(Autosave_Audio_Files);
+        saved_audio_file_list_generation = audio_file_list.generation;
+    }
+    //the questions answered without a journal, appended all at once
+    if (!unsaved_frequency_questions.sequence.empty())
+    {
+        autosave_submit_append(autosave.get(), [directory = store_directory.getChildFile("frequency_questions"), rows = std::move(unsaved_frequency_questions)] {
+            return frequency_question_columns_append(directory, rows);
+        });
+        unsaved_frequency_questions = {};
+    }
+    if (!unsaved_compressor_questions.sequence.empty())
+    {
+        autosave_submit_append(autosave.get(), [directory = store_directory.getChildFile("compressor_questions"), rows = std::move(unsaved_compressor_questions)] {
+            return compressor_question_columns_append(directory, rows);
+        });
+        unsaved_compressor_questions = {};
+    }
+    if (dirty_flags == 0)
+        return;
 
-    //save compressor config list
-    [&] {
-        auto stream = get_file_stream_from_appdata("compressor_game_configs.xml");
-        if (!stream) return;
-        std::string file_text = compressor_game_serialize(&compressor_game_configs);
-        *stream << juce::StringRef(file_text);
-    }();
-    
-    //save previous results
-    [&] {
-        auto stream = get_file_stream_from_appdata("compressor_game_results.xml");
-        if (!stream) return;
-        juce::ValueTree root_node { id_results_root };
-        for (uint32_t i = 0; i < compressor_game_results_history.size(); i++)
-        {
-            juce::ValueTree node = { id_result, {
-                { id_result_score,  compressor_game_results_history[i].score }
-            }};
-            root_node.addChild(node, -1, nullptr);
-        }
-        auto xml_string = root_node.toXmlString();
-        *stream << xml_string;
-    }();
+    if (dirty_flags & autosave_flag(Autosave_Audio_Files))
+    {
+        autosave_submit(autosave.get(), Autosave_Audio_Files, [list = audio_file_list] () mutable {
+            return audio_file_list_serialize(&list);
+        });
+    }
+    if (dirty_flags & autosave_flag(Autosave_Frequency_Game_Configs))
+    {
+        autosave_submit(autosave.get(), Autosave_Frequency_Game_Configs, [configs = frequency_game_configs] () mutable {
+            return frequency_game_serlialize(&configs);
+        });
+    }
+    if (dirty_flags & autosave_flag(Autosave_Compressor_Game_Configs))
+    {
+        autosave_submit(autosave.get(), Autosave_Compressor_Game_Configs, [configs = compressor_game_configs] () mutable {
+            return compressor_game_serialize(&configs);
+        });
+    }
+    if (dirty_flags & autosave_flag(Autosave_Frequency_Game_Results))
+    {
+        autosave_submit(autosave.get(), Autosave_Frequency_Game_Results, [history = frequency_game_results_history, sequence = results_last_sequence] {
+            return frequency_game_results_serialize(history, sequence);
+        });
+    }
+    if (dirty_flags & autosave_flag(Autosave_Compressor_Game_Results))
+    {
+        autosave_submit(autosave.get(), Autosave_Compressor_Game_Results, [history = compressor_game_results_history, sequence = results_last_sequence] {
+            return compressor_game_results_serialize(history, sequence);
+        });
+    }
+    dirty_flags = 0;
 }
 
 void Application_Standalone::to_main_menu()
 {
+    audio_file_settings_panel = nullptr;
+    dirty_flags |= dirty_flags_on_panel_exit;
+    dirty_flags_on_panel_exit = 0;
     frequency_game_io.reset();
     compressor_game_io.reset();
     auto main_menu_panel = std::make_unique < MainMenu_Panel > (
         [this] { to_freq_game_settings(); },
         [this] { to_comp_game_settings(); },
         [this] { to_audio_file_settings(); },
-        [] {}
+        [this] { to_stats(); }
     );
     if (audio_file_list.files.empty())
     {
@@ -434,6 +774,14 @@ void Application_Standalone::to_main_menu()
     main_component->changePanel(std::move(main_menu_panel));
 }
 
+void Application_Standalone::to_stats()
+{
+    assert(frequency_game_io == nullptr);
+    assert(compressor_game_io == nullptr);
+    auto stats_panel = std::make_unique<Stats_Panel>(&frequency_game_stats, &compressor_game_stats, [this] { to_main_menu(); });
+    main_component->changePanel(std::move(stats_panel));
+}
+
 void Application_Standalone::to_audio_file_settings()
 {
     assert(frequency_game_io == nullptr);
@@ -442,8 +790,9 @@ void Application_Standalone::to_audio_file_settings()
         file_player_post_command(&player, { .type = Audio_Command_Stop });
         to_main_menu();
     };
-    auto audio_file_settings_panel = std::make_unique<Audio_File_Settings_Panel>(&player, &audio_file_list,  std::move(on_back_pressed));
-    main_component->changePanel(std::move(audio_file_settings_panel));
+    auto new_panel = std::make_unique<Audio_File_Settings_Panel>(&player, &audio_file_list,  std::move(on_back_pressed));
+    audio_file_settings_panel = new_panel.get();
+    main_component->changePanel(std::move(new_panel));
 }
 
 void Application_Standalone::to_freq_game_settings()
@@ -452,6 +801,8 @@ void Application_Standalone::to_freq_game_settings()
     assert(compressor_game_io == nullptr);
     auto to_main_menu = [&] { this->to_main_menu(); };
     auto to_selector = [&] {
+        dirty_flags |= dirty_flags_on_panel_exit;
+        dirty_flags_on_panel_exit = 0;
         auto back_to_config = [&] { 
             to_freq_game_settings();
         };
@@ -461,9 +812,11 @@ void Application_Standalone::to_freq_game_settings()
             std::move(to_game),
             &audio_file_list
         );
+        audio_file_chooser = selector_panel.get();
         main_component->changePanel(std::move(selector_panel));
     };
 
+    dirty_flags_on_panel_exit |= autosave_flag(Autosave_Frequency_Game_Configs);
     auto config_panel = std::make_unique < Frequency_Config_Panel > (
         &frequency_game_configs, 
         &current_frequency_game_config_idx, 
@@ -477,28 +830,71 @@ void Application_Standalone::to_frequency_game()
 {
     main_component->changePanel(nullptr);
 
+    //straight from the game thread, a slow paint doesn't hold back the audio
     auto observer = [this] (Frequency_Game_Effects *effects) { 
+        if (effects->dsp)
+        {
+            file_player_push_dsp(&player, effects->dsp->dsp_state, effects->dsp->eq_gain_ramp);
+        }
+        if (effects->player)
+        {
+            for (const auto& command : effects->player->commands)
+                file_player_post_command(&player, command);
+        }
+    };
+
+    auto ui_observer = [this] (Frequency_Game_Effects *effects) { 
         if (effects->transition)
         {
             if (effects->transition->in_transition == GameStep_Begin)
             {
+                frequency_game_session = juce::Time::currentTimeMillis();
                 auto new_game_ui = std::make_unique < FrequencyGame_UI > (frequency_game_io.get());
                 frequency_game_ui = new_game_ui.get();
                 main_component->changePanel(std::move(new_game_ui));
             }
         }
-        if (effects->dsp)
+        if (effects->question_result)
         {
-            file_player_push_dsp(&player, effects->dsp->dsp_state);
-        }
-        if (effects->player)
-        {
-            for (const auto& command : effects->player->commands)
-                file_player_post_command(&player, command);
+            const auto &question = *effects->question_result;
+            if (stats_is_new_session(frequency_questions.session, frequency_questions.session.size(), frequency_game_session))
+                stats_begin_session(&frequency_game_stats);
+            frequency_game_stats_add(&frequency_game_stats, question.target_frequency, question.answer_frequency, question.points, question.response_time_ms);
+            if (results_journal)
+            {
+                Journal_Record record = {};
+                record.type = Journal_Record_Frequency_Question;
+                record.frequency_question = { .result = question, .session = frequency_game_session };
+                results_last_sequence = results_journal_append(results_journal.get(), record);
+                frequency_question_columns_push(&frequency_questions, results_last_sequence, frequency_game_session, question);
+            }
+            else
+            {
+                //no journal to batch them, they go with the next autosave
+                frequency_question_columns_push(&unsaved_frequency_questions, ++results_last_sequence, frequency_game_session, question);
+                frequency_question_columns_push(&frequency_questions, results_last_sequence, frequency_game_session, question);
+            }
         }
         if (effects->results)
         {
             frequency_game_results_history.push_back(*effects->results);
+            if (results_journal)
+            {
+                Journal_Record record = {};
+                record.type = Journal_Record_Frequency_Game_Result;
+                record.game_result = { 
+                    .timestamp = effects->results->timestamp,
+                    .score = effects->results->score,
+                    .question_count = effects->results->question_count,
+                    .mean_distance = effects->results->mean_distance,
+                    .mean_response_time_ms = effects->results->mean_response_time_ms
+                };
+                results_last_sequence = results_journal_append(results_journal.get(), record);
+            }
+            else
+            {
+                dirty_flags |= autosave_flag(Autosave_Frequency_Game_Results);
+            }
         }
         if (effects->ui)
         {
@@ -513,25 +909,25 @@ void Application_Standalone::to_frequency_game()
     
     auto selected_file_list = generate_list_of_selected_files(&audio_file_list);
     FrequencyGame_Config config = frequency_game_configs[current_frequency_game_config_idx];
-    auto new_game_state = frequency_game_state_init(config, &selected_file_list);
-    frequency_game_io = frequency_game_io_init(new_game_state);
+    auto game_context = frequency_game_context_init(config, &selected_file_list);
+    auto seed = static_cast<uint64_t>(juce::Random::getSystemRandom().nextInt64());
+    frequency_game_io = frequency_game_io_init(std::move(game_context), frequency_game_state_init(seed));
 
     auto on_quit = [this] { 
-        frequency_game_io->timer.stopTimer();
+        //the player is only driven from one thread at a time
+        game_thread_stop(frequency_game_io->game_thread.get());
         file_player_post_command(&player, { .type = Audio_Command_Stop });
         to_main_menu();
     };
     frequency_game_io->on_quit = std::move(on_quit);
 
     frequency_game_add_observer(frequency_game_io.get(), std::move(observer));
-    frequency_game_add_observer(frequency_game_io.get(), std::move(debug_observer));
+    frequency_game_add_ui_observer(frequency_game_io.get(), std::move(ui_observer));
+    frequency_game_add_ui_observer(frequency_game_io.get(), std::move(debug_observer));
+    frequency_game_record(frequency_game_io.get());
 
     frequency_game_post_event(frequency_game_io.get(), Event { .type = Event_Init });
     frequency_game_post_event(frequency_game_io.get(), Event { .type = Event_Create_UI });
-    frequency_game_io->timer.callback = [io = frequency_game_io.get()] (int64_t timestamp) {
-        frequency_game_post_event(io, Event {.type = Event_Timer_Tick, .value_i64 = timestamp});
-    };
-    frequency_game_io->timer.startTimerHz(60);
 }
 
 
@@ -548,6 +944,8 @@ void Application_Standalone::to_comp_game_settings()
     assert(compressor_game_io == nullptr);
     auto to_main_menu = [&] { this->to_main_menu(); };
     auto to_selector = [&] {
+        dirty_flags |= dirty_flags_on_panel_exit;
+        dirty_flags_on_panel_exit = 0;
         auto back_to_config = [&] { 
             to_comp_game_settings();
         };
@@ -557,9 +955,11 @@ void Application_Standalone::to_comp_game_settings()
             std::move(to_game),
             &audio_file_list
         );
+        audio_file_chooser = selector_panel.get();
         main_component->changePanel(std::move(selector_panel));
     };
 
+    dirty_flags_on_panel_exit |= autosave_flag(Autosave_Compressor_Game_Configs);
     auto config_panel = std::make_unique < Compressor_Config_Panel > (
         &compressor_game_configs, 
         &current_compressor_game_config_idx, 
@@ -573,28 +973,70 @@ void Application_Standalone::to_compressor_game()
 {
     main_component->changePanel(nullptr);
 
+    //straight from the game thread, a slow paint doesn't hold back the audio
     auto observer = [this] (Compressor_Game_Effects *effects) { 
+        if (effects->dsp)
+        {
+            file_player_push_dsp(&player, effects->dsp->dsp_state, effects->dsp->eq_gain_ramp);
+        }
+        if (effects->player)
+        {
+            for (const auto& command : effects->player->commands)
+                file_player_post_command(&player, command);
+        }
+    };
+
+    auto ui_observer = [this] (Compressor_Game_Effects *effects) { 
         if (effects->transition)
         {
             if (effects->transition->in_transition == GameStep_Begin)
             {
+                compressor_game_session = juce::Time::currentTimeMillis();
                 auto new_game_ui = std::make_unique < CompressorGame_UI > (compressor_game_io.get());
                 compressor_game_ui = new_game_ui.get();
                 main_component->changePanel(std::move(new_game_ui));
             }
         }
-        if (effects->dsp)
-        {
-            file_player_push_dsp(&player, effects->dsp->dsp_state);
-        }
-        if (effects->player)
+        if (effects->question_result)
         {
-            for (const auto& command : effects->player->commands)
-                file_player_post_command(&player, command);
+            const auto &question = *effects->question_result;
+            if (stats_is_new_session(compressor_questions.session, compressor_questions.session.size(), compressor_game_session))
+                stats_begin_session(&compressor_game_stats);
+            compressor_game_stats_add(&compressor_game_stats, question.distance, question.response_time_ms);
+            if (results_journal)
+            {
+                Journal_Record record = {};
+                record.type = Journal_Record_Compressor_Question;
+                record.compressor_question = { .result = question, .session = compressor_game_session };
+                results_last_sequence = results_journal_append(results_journal.get(), record);
+                compressor_question_columns_push(&compressor_questions, results_last_sequence, compressor_game_session, question);
+            }
+            else
+            {
+                compressor_question_columns_push(&unsaved_compressor_questions, ++results_last_sequence, compressor_game_session, question);
+                compressor_question_columns_push(&compressor_questions, results_last_sequence, compressor_game_session, question);
+            }
         }
         if (effects->results)
         {
             compressor_game_results_history.push_back(*effects->results);
+            if (results_journal)
+            {
+                Journal_Record record = {};
+                record.type = Journal_Record_Compressor_Game_Result;
+                record.game_result = { 
+                    .timestamp = effects->results->timestamp,
+                    .score = effects->results->score,
+                    .question_count = effects->results->question_count,
+                    .mean_distance = effects->results->mean_distance,
+                    .mean_response_time_ms = effects->results->mean_response_time_ms
+                };
+                results_last_sequence = results_journal_append(results_journal.get(), record);
+            }
+            else
+            {
+                dirty_flags |= autosave_flag(Autosave_Compressor_Game_Results);
+            }
         }
         if (effects->ui)
         {
@@ -609,25 +1051,25 @@ void Application_Standalone::to_compressor_game()
     
     auto selected_file_list = generate_list_of_selected_files(&audio_file_list);
     CompressorGame_Config config = compressor_game_configs[current_compressor_game_config_idx];
-    auto new_game_state = compressor_game_state_init(config, &selected_file_list);
-    compressor_game_io = compressor_game_io_init(new_game_state);
+    auto game_context = compressor_game_context_init(config, &selected_file_list);
+    auto seed = static_cast<uint64_t>(juce::Random::getSystemRandom().nextInt64());
+    compressor_game_io = compressor_game_io_init(std::move(game_context), compressor_game_state_init(seed));
 
     auto on_quit = [this] { 
-        compressor_game_io->timer.stopTimer();
+        //the player is only driven from one thread at a time
+        game_thread_stop(compressor_game_io->game_thread.get());
         file_player_post_command(&player, { .type = Audio_Command_Stop });
         to_main_menu();
     };
     compressor_game_io->on_quit = std::move(on_quit);
 
     compressor_game_add_observer(compressor_game_io.get(), std::move(observer));
-    compressor_game_add_observer(compressor_game_io.get(), std::move(debug_observer));
+    compressor_game_add_ui_observer(compressor_game_io.get(), std::move(ui_observer));
+    compressor_game_add_ui_observer(compressor_game_io.get(), std::move(debug_observer));
+    compressor_game_record(compressor_game_io.get());
 
     compressor_game_post_event(compressor_game_io.get(), Event { .type = Event_Init });
     compressor_game_post_event(compressor_game_io.get(), Event { .type = Event_Create_UI });
-    compressor_game_io->timer.callback = [io = compressor_game_io.get()] (int64_t timestamp) {
-        compressor_game_post_event(io, Event {.type = Event_Timer_Tick, .value_i64 = timestamp});
-    };
-    compressor_game_io->timer.startTimerHz(60);
 }
 
 //------------------------------------------------------------------------
@@ -753,9 +1195,9 @@ File_Player_State file_player_post_command(File_Player *player, Audio_Command co
     return player->player_state;
 }
 
-void file_player_push_dsp(File_Player *player, Channel_DSP_State new_dsp_state)
+void file_player_push_dsp(File_Player *player, Channel_DSP_State new_dsp_state, DSP_EQ_Gain_Ramp eq_gain_ramp)
 {
-    player->dsp_callback.push_new_dsp_state(new_dsp_state);
+    player->dsp_callback.push_new_dsp_state(new_dsp_state, eq_gain_ramp);
 }
 
 void File_Player::changeListenerCallback(juce::ChangeBroadcaster* source)
@@ -5,6 +5,8 @@ struct Audio_File_List
     std::unordered_map<int64_t, Audio_File> files;
     std::unordered_map<int64_t, bool> selected;
     std::vector<int64_t> order;
+    //bumped on every edit that ends up in audio_files.xml
+    uint64_t generation = 0;
 };
 
 
@@ -13,10 +15,34 @@ void remove_files(Audio_File_List *audio_file_list, std::vector<int> indices);
 std::vector<Audio_File> generate_list_of_selected_files(Audio_File_List *audio_file_list);
 std::vector<Audio_File> generate_ordered_list_of_files(Audio_File_List *audio_file_list);
 std::vector<std::string> generate_titles(Audio_File_List *audio_file_list);
+std::vector<bool> generate_validity(Audio_File_List *audio_file_list);
 
 std::string audio_file_list_serialize(Audio_File_List *audio_file_list);
 std::vector<Audio_File> audio_file_list_deserialize(std::string xml_string);
 
+struct Audio_File_Validation_Result
+{
+    int64_t hash;
+    bool is_valid;
+    bool was_rescanned;
+    Audio_File rescanned_file;
+};
+
+//checks that the stored files still exist and rescans the modified ones, off the message thread
+//so that slow or sleeping drives don't hold up startup
+struct Audio_File_Validator
+{
+    std::mutex mutex;
+    std::vector<Audio_File_Validation_Result> results;
+    std::atomic<bool> should_exit;
+    std::atomic<bool> is_done;
+    std::thread thread;
+};
+
+std::unique_ptr<Audio_File_Validator> audio_file_validator_start(std::vector<Audio_File> files, juce::AudioFormatManager *format_manager);
+std::vector<Audio_File_Validation_Result> audio_file_validator_pop_results(Audio_File_Validator *validator);
+void audio_file_validator_stop(Audio_File_Validator *validator);
+
 struct File_Player_State
 {
     Transport_Step step;
@@ -128,10 +154,12 @@ private:
 
 bool file_player_load(File_Player *player, Audio_File *audio_file, int64_t *out_num_samples);
 File_Player_State file_player_post_command(File_Player *player, Audio_Command command);
-void file_player_push_dsp(File_Player *player, Channel_DSP_State new_dsp_state);
+void file_player_push_dsp(File_Player *player, Channel_DSP_State new_dsp_state, DSP_EQ_Gain_Ramp eq_gain_ramp);
 File_Player_State file_player_query_state(File_Player *player);
 
 class Main_Component;
+class Audio_File_Settings_Panel;
+class Audio_File_Chooser;
 
 class Application_Standalone
 {
@@ -142,6 +170,7 @@ class Application_Standalone
 
     void to_main_menu();
     void to_audio_file_settings();
+    void to_stats();
     void to_freq_game_settings();
     void to_frequency_game();
     void to_low_end_frequency_game();
@@ -149,9 +178,17 @@ class Application_Standalone
     void to_compressor_game();
 
     private :
+    void autosave_dirty_targets();
+    void apply_audio_file_validation_results();
+
     File_Player player;
     Audio_File_List audio_file_list;
     Main_Component *main_component;
+    std::unique_ptr<Audio_File_Validator> audio_file_validator;
+    Timer audio_file_validation_timer;
+    Audio_File_Settings_Panel *audio_file_settings_panel = nullptr;
+    //cleared by juce when the panel is replaced
+    juce::Component::SafePointer<Audio_File_Chooser> audio_file_chooser;
     
     std::unique_ptr<FrequencyGame_IO> frequency_game_io;
     std::vector<FrequencyGame_Config> frequency_game_configs = {};
@@ -164,4 +201,25 @@ class Application_Standalone
     size_t current_compressor_game_config_idx = 0;
     std::vector<CompressorGame_Results> compressor_game_results_history = {};
     CompressorGame_UI *compressor_game_ui;
+
+    juce::File store_directory;
+    std::unique_ptr<Results_Journal> results_journal;
+    int64_t results_last_sequence = 0;
+    Frequency_Question_Columns frequency_questions;
+    Compressor_Question_Columns compressor_questions;
+    //without a journal, the questions not yet handed to the autosave
+    Frequency_Question_Columns unsaved_frequency_questions;
+    Compressor_Question_Columns unsaved_compressor_questions;
+    Stats frequency_game_stats;
+    Stats compressor_game_stats;
+    //the time the running game reached GameStep_Begin, stamped on its questions to delimit the stats sessions
+    int64_t frequency_game_session = 0;
+    int64_t compressor_game_session = 0;
+
+    std::unique_ptr<Autosave> autosave;
+    Timer autosave_timer;
+    uint32_t dirty_flags = 0;
+    //the config panels edit the configs in place, they are considered dirty once the panel is left
+    uint32_t dirty_flags_on_panel_exit = 0;
+    uint64_t saved_audio_file_list_generation = 0;
 };
\ No newline at end of file
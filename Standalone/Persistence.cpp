@@ -0,0 +1,440 @@
+#include "../shared/pch.h"
+#include "../shared/shared.h"
+#include "../shared/shared_ui.h"
+#include "../Game/Game.h"
+#include "../Game/Frequency_Game.h"
+#include "../Game/Compressor_Game.h"
+#include "Persistence.h"
+
+#if JUCE_LINUX || JUCE_MAC
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static uint32_t journal_record_checksum(Journal_Record record)
+{
+    record.checksum = 0;
+    //FNV-1a
+    uint32_t hash = 2166136261u;
+    auto *bytes = reinterpret_cast<const uint8_t*>(&record);
+    for (size_t i = 0; i < sizeof(record); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+std::vector<Journal_Record> results_journal_read(juce::File file)
+{
+    std::vector<Journal_Record> records{};
+    if (!file.existsAsFile())
+        return records;
+    auto stream = file.createInputStream();
+    if (!stream || !stream->openedOk())
+        return records;
+
+    auto record_count = checked_cast<size_t>(stream->getTotalLength()) / sizeof(Journal_Record);
+    records.reserve(record_count);
+    for (size_t i = 0; i < record_count; i++)
+    {
+        Journal_Record record;
+        if (stream->read(&record, sizeof(record)) != sizeof(record))
+            break;
+        //a crash during a write leaves garbage at the tail, everything after it is lost anyway
+        if (record.checksum != journal_record_checksum(record))
+            break;
+        records.push_back(record);
+    }
+    return records;
+}
+
+static void results_journal_writer_loop(Results_Journal *journal)
+{
+    //gives a burst of results the chance to share a single sync
+    constexpr auto batch_window = std::chrono::milliseconds(100);
+
+    std::vector<Journal_Record> batch{};
+    std::unique_lock lock { journal->mutex };
+    while (true)
+    {
+        journal->condition.wait(lock, [journal] { return !journal->pending.empty() || journal->should_exit; });
+        if (!journal->should_exit)
+            journal->condition.wait_for(lock, batch_window, [journal] { return journal->should_exit; });
+
+        std::swap(batch, journal->pending);
+        bool should_exit = journal->should_exit;
+        lock.unlock();
+
+        if (!batch.empty())
+        {
+            for (const auto &record : batch)
+                journal->stream->write(&record, sizeof(record));
+            //FileOutputStream::flush() syncs the file to disk
+            journal->stream->flush();
+            batch.clear();
+        }
+
+        lock.lock();
+        if (should_exit && journal->pending.empty())
+            break;
+    }
+}
+
+std::unique_ptr<Results_Journal> results_journal_open(juce::File file, int64_t next_sequence)
+{
+    auto stream = file.createOutputStream();
+    if (!stream || !stream->openedOk())
+    {
+        DBG("couldn't open " << file.getFullPathName());
+        return nullptr;
+    }
+    //drops a torn record left by a crash, so that new records stay aligned
+    auto valid_length = checked_cast<juce::int64>(results_journal_read(file).size() * sizeof(Journal_Record));
+    stream->setPosition(valid_length);
+    stream->truncate();
+
+    auto journal = std::make_unique<Results_Journal>();
+    journal->file = file;
+    journal->stream = std::move(stream);
+    journal->next_sequence = next_sequence;
+    journal->should_exit = false;
+    journal->writer_thread = std::thread(results_journal_writer_loop, journal.get());
+    return journal;
+}
+
+int64_t results_journal_append(Results_Journal *journal, Journal_Record record)
+{
+    {
+        std::lock_guard lock { journal->mutex };
+        record.sequence = journal->next_sequence++;
+        record.checksum = journal_record_checksum(record);
+        journal->pending.push_back(record);
+    }
+    journal->condition.notify_one();
+    return record.sequence;
+}
+
+void results_journal_close(Results_Journal *journal)
+{
+    {
+        std::lock_guard lock { journal->mutex };
+        journal->should_exit = true;
+    }
+    journal->condition.notify_one();
+    journal->writer_thread.join();
+    journal->stream.reset();
+}
+
+static const char *autosave_file_names[Autosave_Target_Count] = {
+    "audio_files.xml",
+    "frequency_game_configs.xml",
+    "compressor_game_configs.xml",
+    "frequency_game_results.xml",
+    "compressor_game_results.xml"
+};
+
+bool write_file_atomically(juce::File file, const std::string &file_text)
+{
+    //the target is only replaced by a rename once the new content is fully on disk
+    juce::TemporaryFile temp_file { file };
+    {
+        auto stream = temp_file.getFile().createOutputStream();
+        if (!stream || !stream->openedOk())
+        {
+            DBG("couldn't open " << temp_file.getFile().getFullPathName());
+            return false;
+        }
+        *stream << juce::StringRef(file_text);
+        stream->flush();
+        if (stream->getStatus().failed())
+            return false;
+    }
+    return temp_file.overwriteTargetFileWithTemporary();
+}
+
+bool sync_directory(juce::File directory)
+{
+#if JUCE_LINUX || JUCE_MAC
+    //the renames of write_file_atomically only survive a power loss once the directory itself is synced
+    int fd = open(directory.getFullPathName().toRawUTF8(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    bool success = fsync(fd) == 0;
+    close(fd);
+    return success;
+#else
+    //NTFS journals the renames
+    juce::ignoreUnused(directory);
+    return true;
+#endif
+}
+
+static void autosave_writer_loop(Autosave *autosave)
+{
+    std::array<autosave_serializer_t, Autosave_Target_Count> batch{};
+    std::vector<autosave_append_t> appends{};
+    std::unique_lock lock { autosave->mutex };
+    while (true)
+    {
+        auto has_pending = [autosave] {
+            return !autosave->pending_appends.empty()
+                || std::any_of(autosave->pending.begin(), autosave->pending.end(), [] (const auto &serializer) { return serializer != nullptr; });
+        };
+        autosave->condition.wait(lock, [&] { return has_pending() || autosave->should_exit; });
+
+        std::swap(batch, autosave->pending);
+        std::swap(appends, autosave->pending_appends);
+        bool should_exit = autosave->should_exit;
+        lock.unlock();
+
+        for (auto &append : appends)
+        {
+            if (!append())
+                DBG("autosave append failed");
+        }
+        appends.clear();
+
+        for (uint32_t target = 0; target < Autosave_Target_Count; target++)
+        {
+            if (!batch[target])
+                continue;
+            std::string file_text = batch[target]();
+            bool success = write_file_atomically(autosave->directory.getChildFile(autosave_file_names[target]), file_text);
+            if (!success)
+                DBG("autosave failed : " << autosave_file_names[target]);
+            batch[target] = nullptr;
+        }
+
+        lock.lock();
+        if (should_exit && !has_pending())
+            break;
+    }
+}
+
+std::unique_ptr<Autosave> autosave_start(juce::File directory)
+{
+    auto autosave = std::make_unique<Autosave>();
+    autosave->directory = directory;
+    autosave->should_exit = false;
+    autosave->writer_thread = std::thread(autosave_writer_loop, autosave.get());
+    return autosave;
+}
+
+void autosave_submit(Autosave *autosave, Autosave_Target target, autosave_serializer_t serializer)
+{
+    assert(target < Autosave_Target_Count);
+    {
+        std::lock_guard lock { autosave->mutex };
+        autosave->pending[target] = std::move(serializer);
+    }
+    autosave->condition.notify_one();
+}
+
+void autosave_submit_append(Autosave *autosave, autosave_append_t append)
+{
+    {
+        std::lock_guard lock { autosave->mutex };
+        autosave->pending_appends.push_back(std::move(append));
+    }
+    autosave->condition.notify_one();
+}
+
+void autosave_stop(Autosave *autosave)
+{
+    {
+        std::lock_guard lock { autosave->mutex };
+        autosave->should_exit = true;
+    }
+    autosave->condition.notify_one();
+    autosave->writer_thread.join();
+}
+
+template<typename T>
+static std::vector<T> column_read(juce::File file)
+{
+    std::vector<T> values{};
+    if (!file.existsAsFile())
+        return values;
+    auto stream = file.createInputStream();
+    if (!stream || !stream->openedOk())
+        return values;
+    values.resize(checked_cast<size_t>(stream->getTotalLength()) / sizeof(T));
+    auto bytes_read = stream->read(values.data(), checked_cast<int>(values.size() * sizeof(T)));
+    values.resize(checked_cast<size_t>(bytes_read) / sizeof(T));
+    return values;
+}
+
+//a crash or a failure in the middle of an append leaves some columns longer than the sequence column,
+//the extra values are overwritten by the next append
+template<typename T>
+static bool column_append(juce::File file, const std::vector<T> &values, size_t row_count)
+{
+    if (values.empty())
+        return true;
+    auto stream = file.createOutputStream();
+    if (!stream || !stream->openedOk())
+    {
+        DBG("couldn't open " << file.getFullPathName());
+        return false;
+    }
+    stream->setPosition(checked_cast<juce::int64>(row_count * sizeof(T)));
+    stream->truncate();
+    stream->write(values.data(), values.size() * sizeof(T));
+    stream->flush();
+    return !stream->getStatus().failed();
+}
+
+static size_t column_row_count(juce::File directory)
+{
+    return checked_cast<size_t>(directory.getChildFile("sequence").getSize()) / sizeof(int64_t);
+}
+
+void frequency_question_columns_push(Frequency_Question_Columns *columns, int64_t sequence, int64_t session, const Frequency_Question_Result &result)
+{
+    columns->sequence.push_back(sequence);
+    columns->session.push_back(session);
+    columns->timestamp.push_back(result.timestamp);
+    columns->file_hash.push_back(result.file_hash);
+    columns->response_time_ms.push_back(result.response_time_ms);
+    columns->target_frequency.push_back(result.target_frequency);
+    columns->answer_frequency.push_back(result.answer_frequency);
+    columns->distance.push_back(result.distance);
+    columns->points.push_back(result.points);
+}
+
+Frequency_Question_Columns frequency_question_columns_load(juce::File directory)
+{
+    Frequency_Question_Columns columns = {
+        .sequence = column_read<int64_t>(directory.getChildFile("sequence")),
+        .session = column_read<int64_t>(directory.getChildFile("session")),
+        .timestamp = column_read<int64_t>(directory.getChildFile("timestamp")),
+        .file_hash = column_read<int64_t>(directory.getChildFile("file_hash")),
+        .response_time_ms = column_read<int64_t>(directory.getChildFile("response_time_ms")),
+        .target_frequency = column_read<uint32_t>(directory.getChildFile("target_frequency")),
+        .answer_frequency = column_read<uint32_t>(directory.getChildFile("answer_frequency")),
+        .distance = column_read<float>(directory.getChildFile("distance")),
+        .points = column_read<int32_t>(directory.getChildFile("points"))
+    };
+    //missing in the stores written before the sessions were kept
+    columns.session.resize(std::max(columns.session.size(), columns.sequence.size()), 0);
+    size_t row_count = std::min({
+        columns.sequence.size(), columns.session.size(), columns.timestamp.size(), columns.file_hash.size(), columns.response_time_ms.size(),
+        columns.target_frequency.size(), columns.answer_frequency.size(), columns.distance.size(), columns.points.size()
+    });
+    columns.sequence.resize(row_count);
+    columns.session.resize(row_count);
+    columns.timestamp.resize(row_count);
+    columns.file_hash.resize(row_count);
+    columns.response_time_ms.resize(row_count);
+    columns.target_frequency.resize(row_count);
+    columns.answer_frequency.resize(row_count);
+    columns.distance.resize(row_count);
+    columns.points.resize(row_count);
+    return columns;
+}
+
+bool frequency_question_columns_append(juce::File directory, const Frequency_Question_Columns &rows)
+{
+    directory.createDirectory();
+    size_t row_count = column_row_count(directory);
+    bool success = column_append(directory.getChildFile("session"), rows.session, row_count);
+    success &= column_append(directory.getChildFile("timestamp"), rows.timestamp, row_count);
+    success &= column_append(directory.getChildFile("file_hash"), rows.file_hash, row_count);
+    success &= column_append(directory.getChildFile("response_time_ms"), rows.response_time_ms, row_count);
+    success &= column_append(directory.getChildFile("target_frequency"), rows.target_frequency, row_count);
+    success &= column_append(directory.getChildFile("answer_frequency"), rows.answer_frequency, row_count);
+    success &= column_append(directory.getChildFile("distance"), rows.distance, row_count);
+    success &= column_append(directory.getChildFile("points"), rows.points, row_count);
+    //last, the rows only exist once this is written
+    if (success)
+        success &= column_append(directory.getChildFile("sequence"), rows.sequence, row_count);
+    return success;
+}
+
+void compressor_question_columns_push(Compressor_Question_Columns *columns, int64_t sequence, int64_t session, const Compressor_Question_Result &result)
+{
+    columns->sequence.push_back(sequence);
+    columns->session.push_back(session);
+    columns->timestamp.push_back(result.timestamp);
+    columns->file_hash.push_back(result.file_hash);
+    columns->response_time_ms.push_back(result.response_time_ms);
+    columns->target_threshold_db.push_back(result.target_threshold_db);
+    columns->target_ratio.push_back(result.target_ratio);
+    columns->target_attack.push_back(result.target_attack);
+    columns->target_release.push_back(result.target_release);
+    columns->answer_threshold_db.push_back(result.answer_threshold_db);
+    columns->answer_ratio.push_back(result.answer_ratio);
+    columns->answer_attack.push_back(result.answer_attack);
+    columns->answer_release.push_back(result.answer_release);
+    columns->distance.push_back(result.distance);
+    columns->points.push_back(result.points);
+}
+
+Compressor_Question_Columns compressor_question_columns_load(juce::File directory)
+{
+    Compressor_Question_Columns columns = {
+        .sequence = column_read<int64_t>(directory.getChildFile("sequence")),
+        .session = column_read<int64_t>(directory.getChildFile("session")),
+        .timestamp = column_read<int64_t>(directory.getChildFile("timestamp")),
+        .file_hash = column_read<int64_t>(directory.getChildFile("file_hash")),
+        .response_time_ms = column_read<int64_t>(directory.getChildFile("response_time_ms")),
+        .target_threshold_db = column_read<float>(directory.getChildFile("target_threshold_db")),
+        .target_ratio = column_read<float>(directory.getChildFile("target_ratio")),
+        .target_attack = column_read<float>(directory.getChildFile("target_attack")),
+        .target_release = column_read<float>(directory.getChildFile("target_release")),
+        .answer_threshold_db = column_read<float>(directory.getChildFile("answer_threshold_db")),
+        .answer_ratio = column_read<float>(directory.getChildFile("answer_ratio")),
+        .answer_attack = column_read<float>(directory.getChildFile("answer_attack")),
+        .answer_release = column_read<float>(directory.getChildFile("answer_release")),
+        .distance = column_read<uint32_t>(directory.getChildFile("distance")),
+        .points = column_read<int32_t>(directory.getChildFile("points"))
+    };
+    //missing in the stores written before the sessions were kept
+    columns.session.resize(std::max(columns.session.size(), columns.sequence.size()), 0);
+    size_t row_count = std::min({
+        columns.sequence.size(), columns.session.size(), columns.timestamp.size(), columns.file_hash.size(), columns.response_time_ms.size(),
+        columns.target_threshold_db.size(), columns.target_ratio.size(), columns.target_attack.size(), columns.target_release.size(),
+        columns.answer_threshold_db.size(), columns.answer_ratio.size(), columns.answer_attack.size(), columns.answer_release.size(),
+        columns.distance.size(), columns.points.size()
+    });
+    columns.sequence.resize(row_count);
+    columns.session.resize(row_count);
+    columns.timestamp.resize(row_count);
+    columns.file_hash.resize(row_count);
+    columns.response_time_ms.resize(row_count);
+    columns.target_threshold_db.resize(row_count);
+    columns.target_ratio.resize(row_count);
+    columns.target_attack.resize(row_count);
+    columns.target_release.resize(row_count);
+    columns.answer_threshold_db.resize(row_count);
+    columns.answer_ratio.resize(row_count);
+    columns.answer_attack.resize(row_count);
+    columns.answer_release.resize(row_count);
+    columns.distance.resize(row_count);
+    columns.points.resize(row_count);
+    return columns;
+}
+
+bool compressor_question_columns_append(juce::File directory, const Compressor_Question_Columns &rows)
+{
+    directory.createDirectory();
+    size_t row_count = column_row_count(directory);
+    bool success = column_append(directory.getChildFile("session"), rows.session, row_count);
+    success &= column_append(directory.getChildFile("timestamp"), rows.timestamp, row_count);
+    success &= column_append(directory.getChildFile("file_hash"), rows.file_hash, row_count);
+    success &= column_append(directory.getChildFile("response_time_ms"), rows.response_time_ms, row_count);
+    success &= column_append(directory.getChildFile("target_threshold_db"), rows.target_threshold_db, row_count);
+    success &= column_append(directory.getChildFile("target_ratio"), rows.target_ratio, row_count);
+    success &= column_append(directory.getChildFile("target_attack"), rows.target_attack, row_count);
+    success &= column_append(directory.getChildFile("target_release"), rows.target_release, row_count);
+    success &= column_append(directory.getChildFile("answer_threshold_db"), rows.answer_threshold_db, row_count);
+    success &= column_append(directory.getChildFile("answer_ratio"), rows.answer_ratio, row_count);
+    success &= column_append(directory.getChildFile("answer_attack"), rows.answer_attack, row_count);
+    success &= column_append(directory.getChildFile("answer_release"), rows.answer_release, row_count);
+    success &= column_append(directory.getChildFile("distance"), rows.distance, row_count);
+    success &= column_append(directory.getChildFile("points"), rows.points, row_count);
+    if (success)
+        success &= column_append(directory.getChildFile("sequence"), rows.sequence, row_count);
+    return success;
+}
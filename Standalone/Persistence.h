@@ -0,0 +1,155 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <array>
+
+enum Journal_Record_Type : uint32_t
+{
+    Journal_Record_None = 0,
+    Journal_Record_Frequency_Game_Result,
+    Journal_Record_Compressor_Game_Result,
+    Journal_Record_Frequency_Question,
+    Journal_Record_Compressor_Question
+};
+
+struct Journal_Game_Result
+{
+    int64_t timestamp;
+    int32_t score;
+    int32_t question_count;
+    float mean_distance;
+    float mean_response_time_ms;
+};
+
+//the session is the time the game reached GameStep_Begin, 0 in the records written before it was kept
+struct Journal_Frequency_Question
+{
+    Frequency_Question_Result result;
+    int64_t session;
+};
+
+struct Journal_Compressor_Question
+{
+    Compressor_Question_Result result;
+    int64_t session;
+};
+
+//fixed size so that a torn write at the end of the file can be detected and dropped
+struct Journal_Record
+{
+    Journal_Record_Type type;
+    uint32_t checksum;
+    int64_t sequence;
+    union {
+        Journal_Game_Result game_result;
+        Journal_Frequency_Question frequency_question;
+        Journal_Compressor_Question compressor_question;
+        uint8_t reserved[80];
+    };
+};
+static_assert(sizeof(Journal_Record) == 96);
+static_assert(std::is_trivially_copyable_v<Journal_Record>);
+
+//append only, the writer thread batches the records and syncs once per batch
+struct Results_Journal
+{
+    juce::File file;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    int64_t next_sequence;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Journal_Record> pending;
+    bool should_exit;
+    std::thread writer_thread;
+};
+
+std::vector<Journal_Record> results_journal_read(juce::File file);
+std::unique_ptr<Results_Journal> results_journal_open(juce::File file, int64_t next_sequence);
+int64_t results_journal_append(Results_Journal *journal, Journal_Record record);
+void results_journal_close(Results_Journal *journal);
+
+enum Autosave_Target : uint32_t
+{
+    Autosave_Audio_Files = 0,
+    Autosave_Frequency_Game_Configs,
+    Autosave_Compressor_Game_Configs,
+    Autosave_Frequency_Game_Results,
+    Autosave_Compressor_Game_Results,
+    Autosave_Target_Count
+};
+
+static inline uint32_t autosave_flag(Autosave_Target target)
+{
+    return 1u << target;
+}
+
+//captures a copy of the data, runs on the writer thread
+using autosave_serializer_t = std::function<std::string()>;
+
+//appends to a file, runs on the writer thread
+using autosave_append_t = std::function<bool()>;
+
+//only the latest snapshot of each target is kept, older pending ones are dropped.
+//appends are never dropped, they run in the order they were submitted
+struct Autosave
+{
+    juce::File directory;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::array<autosave_serializer_t, Autosave_Target_Count> pending;
+    std::vector<autosave_append_t> pending_appends;
+    bool should_exit;
+    std::thread writer_thread;
+};
+
+bool write_file_atomically(juce::File file, const std::string &file_text);
+bool sync_directory(juce::File directory);
+std::unique_ptr<Autosave> autosave_start(juce::File directory);
+void autosave_submit(Autosave *autosave, Autosave_Target target, autosave_serializer_t serializer);
+void autosave_submit_append(Autosave *autosave, autosave_append_t append);
+void autosave_stop(Autosave *autosave);
+
+//one file per field, each one a flat array of values, so a scan only reads the fields it needs.
+//the sequence column is appended last and defines the number of complete rows.
+//the session column is 0 for the rows written before it existed
+struct Frequency_Question_Columns
+{
+    std::vector<int64_t> sequence;
+    std::vector<int64_t> session;
+    std::vector<int64_t> timestamp;
+    std::vector<int64_t> file_hash;
+    std::vector<int64_t> response_time_ms;
+    std::vector<uint32_t> target_frequency;
+    std::vector<uint32_t> answer_frequency;
+    std::vector<float> distance;
+    std::vector<int32_t> points;
+};
+
+struct Compressor_Question_Columns
+{
+    std::vector<int64_t> sequence;
+    std::vector<int64_t> session;
+    std::vector<int64_t> timestamp;
+    std::vector<int64_t> file_hash;
+    std::vector<int64_t> response_time_ms;
+    std::vector<float> target_threshold_db;
+    std::vector<float> target_ratio;
+    std::vector<float> target_attack;
+    std::vector<float> target_release;
+    std::vector<float> answer_threshold_db;
+    std::vector<float> answer_ratio;
+    std::vector<float> answer_attack;
+    std::vector<float> answer_release;
+    std::vector<uint32_t> distance;
+    std::vector<int32_t> points;
+};
+
+void frequency_question_columns_push(Frequency_Question_Columns *columns, int64_t sequence, int64_t session, const Frequency_Question_Result &result);
+Frequency_Question_Columns frequency_question_columns_load(juce::File directory);
+bool frequency_question_columns_append(juce::File directory, const Frequency_Question_Columns &rows);
+
+void compressor_question_columns_push(Compressor_Question_Columns *columns, int64_t sequence, int64_t session, const Compressor_Question_Result &result);
+Compressor_Question_Columns compressor_question_columns_load(juce::File directory);
+bool compressor_question_columns_append(juce::File directory, const Compressor_Question_Columns &rows);
@@ -8,6 +8,7 @@
 #include "../Game/Compressor_Game.h"
 #include "../Game/Compressor_Game_UI.h"
 #include "../Game/Frequency_Game_UI.h"
+#include "Persistence.h"
 #include "Application_Standalone.h"
 #include "Standalone_UI.h"
 
@@ -264,17 +264,10 @@ class Audio_File_Chooser : public juce::Component
 public:
     Audio_File_Chooser(std::function<void()> onBackClicked,
                        std::function<void()> onBeginClicked,
-                       Audio_File_List *audio_file_list)
-    : list_comp(true)
+                       Audio_File_List *audioFileList)
+    : list_comp(true),
+      audio_file_list(audioFileList)
     {
-        auto validate_next_button = [&] (const std::vector<bool> & new_selection)
-        {
-            if (std::any_of(new_selection.begin(), new_selection.end(), [](bool val) { return val; }))
-                bottom.next_button.setEnabled(true);
-            else
-                bottom.next_button.setEnabled(false);
-        };
-        
         std::vector<juce::String> file_names{};
         std::vector<bool> initial_selection{};
         for (uint64_t hash : audio_file_list->order)
@@ -282,10 +275,8 @@ public:
             file_names.push_back(audio_file_list->files.at(hash).title);
             initial_selection.push_back(audio_file_list->selected.at(hash));
         }
-        validate_next_button(initial_selection);
 
-        list_comp.selection_changed_callback =
-            [audio_file_list, selection_changed = std::move(validate_next_button)] (std::vector<bool> *new_selection)
+        list_comp.selection_changed_callback = [this] (std::vector<bool> *new_selection)
         {
             assert(new_selection->size() == audio_file_list->order.size());
             for (uint32_t i = 0; i < new_selection->size(); i++)
@@ -293,7 +284,7 @@ public:
                 uint64_t hash = audio_file_list->order[i];
                 audio_file_list->selected.at(hash) = new_selection->at(i);
             }
-            selection_changed(*new_selection);
+            update_next_button();
         };
         list_comp.set_rows(file_names, initial_selection);
         
@@ -306,6 +297,7 @@ public:
         addAndMakeVisible(header);
         addAndMakeVisible(list_comp);
         addAndMakeVisible(bottom);
+        update_next_button();
     }
 
     void resized() override
@@ -318,12 +310,23 @@ public:
 
         list_comp.setBounds(r);
     }
+
+    //missing files are skipped when the game starts.
+    //the validity is read each time, the background validation may still be changing it
+    void update_next_button()
+    {
+        bool has_valid_selection = false;
+        for (uint64_t hash : audio_file_list->order)
+            has_valid_selection |= audio_file_list->selected.at(hash) && audio_file_list->files.at(hash).is_valid;
+        bottom.next_button.setEnabled(has_valid_selection);
+    }
     
 
 private:
     GameUI_Header header;
     Selection_List list_comp;
     GameUI_Bottom bottom;
+    Audio_File_List *audio_file_list;
 };
 
 
@@ -374,7 +377,8 @@ public:
         if (rowNumber >= getNumRows()) 
             return;
         auto bounds = juce::Rectangle { 0, 0, width, height };
-        g.setColour(juce::Colours::white);
+        bool is_valid = row_validity[checked_cast<size_t>(rowNumber)];
+        g.setColour(is_valid ? juce::Colours::white : juce::Colours::grey);
         g.drawText(row_texts[checked_cast<size_t>(rowNumber)], bounds.reduced(2), juce::Justification::centredLeft);
         if (rowIsSelected)
         {
@@ -475,10 +479,13 @@ public:
     }
 
     void set_rows(const std::vector<std::string> &rowTexts,
-                  const std::vector<bool> &selection)
+                  const std::vector<bool> &selection,
+                  const std::vector<bool> &validity)
     {
         assert(selection.size() == rowTexts.size());
+        assert(validity.size() == rowTexts.size());
         row_texts = std::move(rowTexts);
+        row_validity = validity;
 
         juce::SparseSet < int > selected_juce{};
         for (uint32_t i = 0; i < selection.size(); i++)
@@ -489,6 +496,14 @@ public:
         list_comp.updateContent();
         list_comp.setSelectedRows(selected_juce, juce::dontSendNotification);
     }
+
+    //doesn't touch the selection
+    void set_rows_validity(const std::vector<bool> &validity)
+    {
+        assert(validity.size() == row_texts.size());
+        row_validity = validity;
+        list_comp.repaint();
+    }
     
 
     std::function<void(std::vector<juce::File> files)> file_dropped_callback;
@@ -498,6 +513,7 @@ public:
 
 private:
     std::vector<std::string> row_texts;
+    std::vector<bool> row_validity;
     juce::ListBox list_comp = { {}, this };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Audio_Files_ListBox)
@@ -561,7 +577,7 @@ public:
                 auto selection = std::vector(titles.size(), false);
                 if(files_dropped.size() == 1)
                     selection.back() = true;
-                file_list_component.set_rows(titles, selection);
+                file_list_component.set_rows(titles, selection, generate_validity(audio_file_list));
             };
 
             file_list_component.delete_pressed_callback = [&] ()
@@ -570,16 +586,17 @@ public:
                 remove_files(audio_file_list, files_to_remove);
                 auto titles = generate_titles(audio_file_list);
                 auto selection = std::vector(titles.size(), false);
-                file_list_component.set_rows(titles, selection);
+                file_list_component.set_rows(titles, selection, generate_validity(audio_file_list));
             };
             auto titles = generate_titles(audio_file_list);
             auto selection = std::vector(titles.size(), false);
-            file_list_component.set_rows(titles, selection);
+            file_list_component.set_rows(titles, selection, generate_validity(audio_file_list));
             addAndMakeVisible(file_list_component);
         }
         
         thumbnail.loop_bounds_changed = [&] (juce::Range < int64_t > new_loop_bounds_ms){
             audio_file_list->files.at(selected_file_hash).loop_bounds_ms = new_loop_bounds_ms;
+            audio_file_list->generation++;
             Audio_Command command = {
                 .type = Audio_Command_Update_Loop,
                 .loop_start_ms = new_loop_bounds_ms.getStart(),
@@ -590,8 +607,11 @@ public:
         addAndMakeVisible(thumbnail);
         frequency_bounds_slider.on_mix_max_changed = 
             [&] (float begin, float end, float) {
-            if(file_is_selected)
+            if (file_is_selected)
+            {
                 audio_file_list->files.at(selected_file_hash).freq_bounds = { (uint32_t)begin, (uint32_t)end };
+                audio_file_list->generation++;
+            }
         };
         addAndMakeVisible(frequency_bounds_slider);
         
@@ -613,7 +633,7 @@ public:
                         auto selection = std::vector(titles.size(), false);
                         if(files_chosen.size() == 1)
                             selection.back() = true;
-                        file_list_component.set_rows(titles, selection);
+                        file_list_component.set_rows(titles, selection, generate_validity(audio_file_list));
                     };
                     open_file_dialog->launchAsync (flag, std::move(callback));
                 };
@@ -632,7 +652,7 @@ public:
                     remove_files(audio_file_list, files_to_remove);
                     auto titles = generate_titles(audio_file_list);
                     auto selection = std::vector(titles.size(), false);
-                    file_list_component.set_rows(titles, selection);
+                    file_list_component.set_rows(titles, selection, generate_validity(audio_file_list));
                 };
                 column.add_button(delete_path, std::move(click_delete));
             }
@@ -650,6 +670,12 @@ public:
         }
     }
 
+    //called as the background validation of the library progresses
+    void update_rows_validity()
+    {
+        file_list_component.set_rows_validity(generate_validity(audio_file_list));
+    }
+
     void resized() override
     {
         auto r = getLocalBounds().reduced (4);
@@ -729,7 +755,6 @@ public :
         
         stats_button.setSize(100, 40);
         stats_button.setButtonText("Statistics");
-        stats_button.setEnabled(false);
         stats_button.onClick = [click = std::move(toStats)] {
             click();
         };
@@ -757,6 +782,41 @@ public :
 };
 
 
+//------------------------------------------------------------------------
+class Stats_Panel : public juce::Component
+{
+public :
+    Stats_Panel(const Stats *frequency_game_stats,
+                const Stats *compressor_game_stats,
+                std::function<void()> && onClickBack)
+    :   frequency_table("Learn EQs, by octave", frequency_game_stats, "oct"),
+        compressor_table("Learn Compressors", compressor_game_stats, "steps")
+    {
+        header.onBackClicked = [click = std::move(onClickBack)] {
+            click();
+        };
+        game_ui_header_update(&header, "Statistics", {});
+        addAndMakeVisible(header);
+        addAndMakeVisible(frequency_table);
+        addAndMakeVisible(compressor_table);
+    }
+
+    void resized() override
+    {
+        auto r = getLocalBounds().reduced(4);
+        header.setBounds(r.removeFromTop(header.getHeight()));
+        compressor_table.setBounds(r.removeFromBottom(28 + 2 * 18));
+        r.removeFromBottom(10);
+        frequency_table.setBounds(r);
+    }
+
+private :
+    GameUI_Header header;
+    Stats_Table frequency_table;
+    Stats_Table compressor_table;
+};
+
+
 class Main_Component : public juce::Component
 {
 public :
@@ -0,0 +1 @@
+pwsh -Command "$dir = (Resolve-Path .\).tostring(); $dir = $dir + '\'; echo $dir; (cmake --build cmake-build --target MixTrainer_Game_Bench) | foreach-object{ $_.replace($dir,'')} | foreach-object{ $_.replace($dir,'')}"
\ No newline at end of file
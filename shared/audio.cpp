@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "shared.h"
+#include "audio.h"
+
+float audio_peak(const float *samples, int sample_count)
+{
+    if (sample_count <= 0)
+        return 0.0f;
+    auto range = juce::FloatVectorOperations::findMinAndMax(samples, sample_count);
+    return std::max(std::abs(range.getStart()), std::abs(range.getEnd()));
+}
+
+double audio_sum_of_squares(const float *samples, int sample_count)
+{
+    float accumulators[8] = {};
+    int i = 0;
+    for (; i + 8 <= sample_count; i += 8)
+    {
+        for (int lane = 0; lane < 8; lane++)
+            accumulators[lane] += samples[i + lane] * samples[i + lane];
+    }
+    double sum = 0.0;
+    for (int lane = 0; lane < 8; lane++)
+        sum += accumulators[lane];
+    for (; i < sample_count; i++)
+        sum += samples[i] * samples[i];
+    return sum;
+}
+
+//transposed direct form 2, in and out can be the same buffer
+void biquad_process(Biquad *biquad, const float *in, float *out, int sample_count)
+{
+    float b0 = biquad->b0, b1 = biquad->b1, b2 = biquad->b2, a1 = biquad->a1, a2 = biquad->a2;
+    float z1 = biquad->z1, z2 = biquad->z2;
+    for (int i = 0; i < sample_count; i++)
+    {
+        float x = in[i];
+        float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        out[i] = y;
+    }
+    biquad->z1 = z1;
+    biquad->z2 = z2;
+}
+
+//the two K-weighting stages of ITU-R BS.1770, recomputed for any sample rate
+static Biquad k_weighting_shelf(double sample_rate)
+{
+    double f0 = 1681.974450955533;
+    double gain_db = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(juce::MathConstants<double>::pi * f0 / sample_rate);
+    double vh = std::pow(10.0, gain_db / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    return {
+        .b0 = (float)((vh + vb * k / q + k * k) / a0),
+        .b1 = (float)(2.0 * (k * k - vh) / a0),
+        .b2 = (float)((vh - vb * k / q + k * k) / a0),
+        .a1 = (float)(2.0 * (k * k - 1.0) / a0),
+        .a2 = (float)((1.0 - k / q + k * k) / a0),
+        .z1 = 0.0f,
+        .z2 = 0.0f
+    };
+}
+
+static Biquad k_weighting_high_pass(double sample_rate)
+{
+    double f0 = 38.13547087602444;
+    double q = 0.5003270373238773;
+    double k = std::tan(juce::MathConstants<double>::pi * f0 / sample_rate);
+    double a0 = 1.0 + k / q + k * k;
+    return {
+        .b0 = 1.0f,
+        .b1 = -2.0f,
+        .b2 = 1.0f,
+        .a1 = (float)(2.0 * (k * k - 1.0) / a0),
+        .a2 = (float)((1.0 - k / q + k * k) / a0),
+        .z1 = 0.0f,
+        .z2 = 0.0f
+    };
+}
+
+void bus_meter_prepare(Bus_Meter *meter, double sample_rate, int max_block_size)
+{
+    for (int channel = 0; channel < bus_meter_max_channels; channel++)
+    {
+        meter->shelf[channel] = k_weighting_shelf(sample_rate);
+        meter->high_pass[channel] = k_weighting_high_pass(sample_rate);
+    }
+    meter->scratch.assign(checked_cast<size_t>(std::max(max_block_size, 1)), 0.0f);
+
+    meter->window_length = std::max(1, static_cast<int>(sample_rate * 0.1));
+    meter->window_position = 0;
+    meter->window_peak = 0.0f;
+    meter->window_sum_of_squares = 0.0;
+    meter->window_weighted_sum = 0.0;
+    meter->window_channel_count = 0;
+    std::fill(std::begin(meter->weighted_sums), std::end(meter->weighted_sums), 0.0);
+    std::fill(std::begin(meter->weighted_sample_counts), std::end(meter->weighted_sample_counts), 0);
+    meter->weighted_index = 0;
+}
+
+bool bus_meter_process(Bus_Meter *meter, const float *const *channels, int channel_count, int sample_count, Level_Meter_Values *out)
+{
+    if (meter->scratch.empty())
+        return false;
+    channel_count = std::min(channel_count, bus_meter_max_channels);
+    bool has_completed_window = false;
+    int offset = 0;
+    while (offset < sample_count)
+    {
+        int length = std::min({
+            sample_count - offset,
+            meter->window_length - meter->window_position,
+            static_cast<int>(meter->scratch.size())
+        });
+        float *weighted = meter->scratch.data();
+        for (int channel = 0; channel < channel_count; channel++)
+        {
+            const float *samples = channels[channel] + offset;
+            meter->window_peak = std::max(meter->window_peak, audio_peak(samples, length));
+            meter->window_sum_of_squares += audio_sum_of_squares(samples, length);
+            biquad_process(&meter->shelf[channel], samples, weighted, length);
+            biquad_process(&meter->high_pass[channel], weighted, weighted, length);
+            meter->window_weighted_sum += audio_sum_of_squares(weighted, length);
+        }
+        meter->window_channel_count = std::max(meter->window_channel_count, channel_count);
+        meter->window_position += length;
+        offset += length;
+
+        if (meter->window_position < meter->window_length)
+            continue;
+
+        //the loudness adds up the mean square of every channel, it isn't averaged across them
+        meter->weighted_sums[meter->weighted_index] = meter->window_weighted_sum;
+        meter->weighted_sample_counts[meter->weighted_index] = meter->window_length;
+        meter->weighted_index = (meter->weighted_index + 1) % bus_meter_window_count;
+        double weighted_total = 0.0;
+        int64_t weighted_sample_total = 0;
+        for (int i = 0; i < bus_meter_window_count; i++)
+        {
+            weighted_total += meter->weighted_sums[i];
+            weighted_sample_total += meter->weighted_sample_counts[i];
+        }
+
+        double mean_square = meter->window_sum_of_squares / (double(meter->window_length) * std::max(1, meter->window_channel_count));
+        out->peak_db = juce::Decibels::gainToDecibels(meter->window_peak);
+        out->rms_db = juce::Decibels::gainToDecibels(static_cast<float>(std::sqrt(mean_square)));
+        out->short_term_lufs = weighted_total > 0.0
+            ? static_cast<float>(-0.691 + 10.0 * std::log10(weighted_total / double(weighted_sample_total)))
+            : -100.0f;
+
+        meter->window_position = 0;
+        meter->window_peak = 0.0f;
+        meter->window_sum_of_squares = 0.0;
+        meter->window_weighted_sum = 0.0;
+        meter->window_channel_count = 0;
+        has_completed_window = true;
+    }
+    return has_completed_window;
+}
@@ -0,0 +1,46 @@
+//audio thread kernels, they don't allocate and don't lock
+
+//the loops keep several accumulators so that the compiler can vectorize them
+float audio_peak(const float *samples, int sample_count);
+double audio_sum_of_squares(const float *samples, int sample_count);
+
+struct Biquad
+{
+    float b0, b1, b2, a1, a2;
+    float z1, z2;
+};
+
+void biquad_process(Biquad *biquad, const float *in, float *out, int sample_count);
+
+struct Level_Meter_Values
+{
+    float peak_db;
+    float rms_db;
+    float short_term_lufs;
+};
+
+static constexpr int bus_meter_max_channels = 8;
+static constexpr int bus_meter_window_count = 30;
+
+//peak and rms over 100 ms windows, short term loudness (ITU-R BS.1770, K-weighted) over the last 30 of them
+struct Bus_Meter
+{
+    Biquad shelf[bus_meter_max_channels];
+    Biquad high_pass[bus_meter_max_channels];
+    std::vector<float> scratch;
+
+    int window_length;
+    int window_position;
+    float window_peak;
+    double window_sum_of_squares;
+    double window_weighted_sum;
+    int window_channel_count;
+
+    double weighted_sums[bus_meter_window_count];
+    int weighted_sample_counts[bus_meter_window_count];
+    int weighted_index;
+};
+
+void bus_meter_prepare(Bus_Meter *meter, double sample_rate, int max_block_size);
+//true when a window was completed, out then holds its values
+bool bus_meter_process(Bus_Meter *meter, const float *const *channels, int channel_count, int sample_count, Level_Meter_Values *out);
@@ -72,20 +72,8 @@ juce::dsp::IIR::Coefficients<float>::Ptr make_coefficients(DSP_EQ_Band band, dou
     }
 }
 
-void channel_dsp_update_chain(Channel_DSP_Chain *dsp_chain,
-                              Channel_DSP_State state,
-                              juce::CriticalSection *lock,
-                              double sample_rate)
+static void channel_dsp_update_dynamics(Channel_DSP_Chain *dsp_chain, const Channel_DSP_State &state)
 {
-    for (auto i = 0; i < 1 /* une seule bande pour l'instant */; ++i) {
-        auto new_coefficients = make_coefficients(state.eq_bands[i], sample_rate);
-        assert(new_coefficients);
-        {
-            juce::ScopedLock processLock (*lock);
-            if (i == 0)
-                *dsp_chain->get<0>().state = *new_coefficients;
-        }
-    }
     //compressor
     dsp_chain->setBypassed<1>(!state.comp.is_on);
     dsp_chain->setBypassed<2>(!state.comp.is_on);
@@ -102,6 +90,700 @@ void channel_dsp_update_chain(Channel_DSP_Chain *dsp_chain,
     dsp_chain->get<3>().setGainDecibels ((float)state.gain_db);
 }
 
+void channel_dsp_update_chain(Channel_DSP_Chain *dsp_chain,
+                              Channel_DSP_State state,
+                              juce::CriticalSection *lock,
+                              double sample_rate,
+                              const std::function<void()> &installed_under_lock)
+{
+    for (auto i = 0; i < 1 /* une seule bande pour l'instant */; ++i) {
+        auto new_coefficients = make_coefficients(state.eq_bands[i], sample_rate);
+        assert(new_coefficients);
+        {
+            juce::ScopedLock processLock (*lock);
+            if (i == 0)
+                *dsp_chain->get<0>().state = *new_coefficients;
+            if (installed_under_lock)
+                installed_under_lock();
+        }
+    }
+    channel_dsp_update_dynamics(dsp_chain, state);
+}
+
+void make_biquad_coefficients(DSP_EQ_Band band, double sample_rate, float out_coefficients[5])
+{
+    using Array_Coefficients = juce::dsp::IIR::ArrayCoefficients<float>;
+    auto second_order = [&] (const std::array<float, 6> &c) {
+        float a0 = c[3];
+        out_coefficients[0] = c[0] / a0;
+        out_coefficients[1] = c[1] / a0;
+        out_coefficients[2] = c[2] / a0;
+        out_coefficients[3] = c[4] / a0;
+        out_coefficients[4] = c[5] / a0;
+    };
+    auto first_order = [&] (const std::array<float, 4> &c) {
+        float a0 = c[2];
+        out_coefficients[0] = c[0] / a0;
+        out_coefficients[1] = c[1] / a0;
+        out_coefficients[2] = 0.0f;
+        out_coefficients[3] = c[3] / a0;
+        out_coefficients[4] = 0.0f;
+    };
+    switch (band.type) {
+        case Filter_Low_Pass:
+            second_order(Array_Coefficients::makeLowPass (sample_rate, band.frequency, band.quality)); break;
+        case Filter_LowPass1st:
+            first_order(Array_Coefficients::makeFirstOrderLowPass (sample_rate, band.frequency)); break;
+        case Filter_LowShelf:
+            second_order(Array_Coefficients::makeLowShelf (sample_rate, band.frequency, band.quality, band.gain)); break;
+        case Filter_BandPass:
+            second_order(Array_Coefficients::makeBandPass (sample_rate, band.frequency, band.quality)); break;
+        case Filter_AllPass:
+            second_order(Array_Coefficients::makeAllPass (sample_rate, band.frequency, band.quality)); break;
+        case Filter_AllPass1st:
+            first_order(Array_Coefficients::makeFirstOrderAllPass (sample_rate, band.frequency)); break;
+        case Filter_Notch:
+            second_order(Array_Coefficients::makeNotch (sample_rate, band.frequency, band.quality)); break;
+        case Filter_Peak:
+            second_order(Array_Coefficients::makePeakFilter (sample_rate, band.frequency, band.quality, band.gain)); break;
+        case Filter_HighShelf:
+            second_order(Array_Coefficients::makeHighShelf (sample_rate, band.frequency, band.quality, band.gain)); break;
+        case Filter_HighPass1st:
+            first_order(Array_Coefficients::makeFirstOrderHighPass (sample_rate, band.frequency)); break;
+        case Filter_HighPass:
+            second_order(Array_Coefficients::makeHighPass (sample_rate, band.frequency, band.quality)); break;
+        case Filter_None:
+        case Filter_LastID:
+        default:
+            second_order({ 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f }); break;
+    }
+}
+
+void channel_dsp_prepare_realtime(Channel_DSP_Chain *dsp_chain, const juce::dsp::ProcessSpec &spec, const Channel_DSP_State &state)
+{
+    //allocates the biquad once, the audio thread only overwrites its coefficients
+    *dsp_chain->get<0>().state = juce::dsp::IIR::Coefficients<float>(1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+    dsp_chain->prepare(spec);
+    //the gain stage ramps instead of jumping, a switch between two mixes doesn't click
+    dsp_chain->get<3>().setRampDurationSeconds(0.02);
+    channel_dsp_update_chain_realtime(dsp_chain, state, spec.sampleRate);
+    dsp_chain->reset();
+}
+
+void channel_dsp_update_chain_realtime(Channel_DSP_Chain *dsp_chain, const Channel_DSP_State &state, double sample_rate)
+{
+    channel_dsp_apply_params(dsp_chain, channel_dsp_make_params(state, sample_rate));
+}
+
+Channel_DSP_Params channel_dsp_make_params(const Channel_DSP_State &state, double sample_rate)
+{
+    Channel_DSP_Params params = {
+        .sample_rate = sample_rate,
+        .eq_coefficients = {},
+        .is_compressor_on = state.comp.is_on,
+        .threshold = state.comp.threshold_gain,
+        .ratio = state.comp.ratio,
+        .attack = state.comp.attack,
+        .release = state.comp.release,
+        .makeup_gain = state.comp.makeup_gain,
+        .gain_db = static_cast<float>(state.gain_db)
+    };
+    make_biquad_coefficients(state.eq_bands[0], sample_rate, params.eq_coefficients[0]);
+    return params;
+}
+
+//only copies, nothing is computed from the state
+void channel_dsp_apply_params(Channel_DSP_Chain *dsp_chain, const Channel_DSP_Params &params)
+{
+    auto &raw_coefficients = dsp_chain->get<0>().state->coefficients;
+    assert(raw_coefficients.size() == 5);
+    std::copy(params.eq_coefficients[0], params.eq_coefficients[0] + 5, raw_coefficients.begin());
+
+    dsp_chain->setBypassed<1>(!params.is_compressor_on);
+    dsp_chain->setBypassed<2>(!params.is_compressor_on);
+    if (params.is_compressor_on)
+    {
+        dsp_chain->get<1>().setThreshold(params.threshold);
+        dsp_chain->get<1>().setRatio(params.ratio);
+        dsp_chain->get<1>().setAttack(params.attack);
+        dsp_chain->get<1>().setRelease(params.release);
+        dsp_chain->get<2>().setGainLinear(params.makeup_gain);
+    }
+    dsp_chain->get<3>().setGainDecibels(params.gain_db);
+}
+
+bool channel_dsp_equal(const Channel_DSP_State &a, const Channel_DSP_State &b)
+{
+    const DSP_EQ_Band &band_a = a.eq_bands[0];
+    const DSP_EQ_Band &band_b = b.eq_bands[0];
+    return a.gain_db == b.gain_db
+        && band_a.type == band_b.type
+        && band_a.frequency == band_b.frequency
+        && band_a.quality == band_b.quality
+        && band_a.gain == band_b.gain
+        && a.comp.is_on == b.comp.is_on
+        && a.comp.threshold_gain == b.comp.threshold_gain
+        && a.comp.ratio == b.comp.ratio
+        && a.comp.attack == b.comp.attack
+        && a.comp.release == b.comp.release
+        && a.comp.makeup_gain == b.comp.makeup_gain;
+}
+
+bool game_channel_equal(const Game_Channel &a, const Game_Channel &b)
+{
+    return a.id == b.id
+        && a.min_freq == b.min_freq
+        && a.max_freq == b.max_freq
+        && std::strncmp(a.name, b.name, sizeof(a.name)) == 0;
+}
+
+bool channel_list_diff(const std::vector<Game_Channel> &from, const std::vector<Game_Channel> &to, std::vector<Channel_List_Op> *out_ops)
+{
+    std::unordered_map<uint32_t, const Game_Channel*> from_by_id;
+    std::unordered_set<uint32_t> to_ids;
+    for (const auto &channel : from)
+        from_by_id.emplace(channel.id, &channel);
+    for (const auto &channel : to)
+        to_ids.insert(channel.id);
+
+    std::vector<Channel_List_Op> ops;
+    std::vector<uint32_t> kept_order;
+    for (const auto &channel : from)
+    {
+        if (to_ids.contains(channel.id))
+            kept_order.push_back(channel.id);
+        else
+            ops.push_back({ .type = Channel_List_Remove, .index = 0, .channel = channel });
+    }
+
+    size_t kept_index = 0;
+    for (uint32_t i = 0; i < to.size(); i++)
+    {
+        auto it = from_by_id.find(to[i].id);
+        if (it == from_by_id.end())
+        {
+            ops.push_back({ .type = Channel_List_Insert, .index = i, .channel = to[i] });
+            continue;
+        }
+        if (kept_order[kept_index++] != to[i].id)
+            return false;
+        if (!game_channel_equal(*it->second, to[i]))
+            ops.push_back({ .type = Channel_List_Update, .index = i, .channel = to[i] });
+    }
+    *out_ops = std::move(ops);
+    return true;
+}
+
+bool channel_list_apply(std::vector<Game_Channel> *list, const std::vector<Channel_List_Op> &ops)
+{
+    for (const auto &op : ops)
+    {
+        auto it = std::find_if(list->begin(), list->end(), [&] (const Game_Channel &channel) { return channel.id == op.channel.id; });
+        switch (op.type)
+        {
+            case Channel_List_Insert :
+            {
+                if (it != list->end() || op.index > list->size())
+                    return false;
+                list->insert(list->begin() + op.index, op.channel);
+            } break;
+            case Channel_List_Remove :
+            {
+                if (it == list->end())
+                    return false;
+                list->erase(it);
+            } break;
+            case Channel_List_Update :
+            {
+                if (it == list->end())
+                    return false;
+                *it = op.channel;
+            } break;
+            default :
+                return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t game_channel_handle(uint32_t slot_index, uint32_t generation)
+{
+    return (generation << game_channel_index_bits) | slot_index;
+}
+
+int multitrack_model_find_game_channel(const MuliTrack_Model *model, int64_t game_channel_id)
+{
+    if (game_channel_id < 0 || game_channel_id > UINT32_MAX)
+        return -1;
+    uint32_t id = static_cast<uint32_t>(game_channel_id);
+    uint32_t slot_index = id & game_channel_index_mask;
+    if (slot_index >= model->game_channel_slots.size())
+        return -1;
+    const Game_Channel_Slot &slot = model->game_channel_slots[slot_index];
+    if (slot.dense_index == -1 || slot.generation != id >> game_channel_index_bits)
+        return -1;
+    return slot.dense_index;
+}
+
+uint32_t multitrack_model_add_game_channel(MuliTrack_Model *model, Game_Channel channel)
+{
+    uint32_t slot_index;
+    if (!model->free_game_channel_slots.empty())
+    {
+        slot_index = model->free_game_channel_slots.back();
+        model->free_game_channel_slots.pop_back();
+    }
+    else
+    {
+        assert(model->game_channel_slots.size() <= game_channel_index_mask);
+        slot_index = checked_cast<uint32_t>(model->game_channel_slots.size());
+        model->game_channel_slots.push_back({ .generation = 0, .dense_index = -1 });
+    }
+    Game_Channel_Slot &slot = model->game_channel_slots[slot_index];
+    slot.dense_index = checked_cast<int32_t>(model->game_channels.size());
+    channel.id = game_channel_handle(slot_index, slot.generation);
+    model->game_channels.push_back(channel);
+    //the generations of the free slots start over when a saved list is loaded,
+    //a daw channel still bound to a channel deleted before that can match the new one
+    int assigned_count = 0;
+    for (const auto &daw_channel : model->daw_channels)
+    {
+        if (daw_channel.assigned_game_channel_id == channel.id)
+            assigned_count++;
+    }
+    model->assigned_daw_track_count.push_back(assigned_count);
+    return channel.id;
+}
+
+//keeps the order, the channels after the removed one shift down
+void multitrack_model_remove_game_channel(MuliTrack_Model *model, uint32_t game_channel_id)
+{
+    int dense_index = multitrack_model_find_game_channel(model, game_channel_id);
+    assert(dense_index != -1);
+    if (dense_index == -1)
+        return;
+    model->game_channels.erase(model->game_channels.begin() + dense_index);
+    model->assigned_daw_track_count.erase(model->assigned_daw_track_count.begin() + dense_index);
+    for (size_t i = checked_cast<size_t>(dense_index); i < model->game_channels.size(); i++)
+        model->game_channel_slots[model->game_channels[i].id & game_channel_index_mask].dense_index = checked_cast<int32_t>(i);
+
+    uint32_t slot_index = game_channel_id & game_channel_index_mask;
+    Game_Channel_Slot &slot = model->game_channel_slots[slot_index];
+    slot.dense_index = -1;
+    slot.generation = (slot.generation + 1) & (UINT32_MAX >> game_channel_index_bits);
+    model->free_game_channel_slots.push_back(slot_index);
+}
+
+void multitrack_model_set_game_channels(MuliTrack_Model *model, const std::vector<Game_Channel> &channels)
+{
+    model->game_channels.clear();
+    model->assigned_daw_track_count.clear();
+    model->game_channel_slots.clear();
+    model->free_game_channel_slots.clear();
+
+    std::vector<Game_Channel> displaced;
+    for (const auto &channel : channels)
+    {
+        uint32_t slot_index = channel.id & game_channel_index_mask;
+        if (slot_index >= model->game_channel_slots.size())
+            model->game_channel_slots.resize(slot_index + 1, { .generation = 0, .dense_index = -1 });
+        Game_Channel_Slot &slot = model->game_channel_slots[slot_index];
+        if (slot.dense_index != -1)
+        {
+            displaced.push_back(channel);
+            continue;
+        }
+        slot.generation = channel.id >> game_channel_index_bits;
+        slot.dense_index = checked_cast<int32_t>(model->game_channels.size());
+        model->game_channels.push_back(channel);
+        model->assigned_daw_track_count.push_back(0);
+    }
+    //the lowest free slots are handed out first
+    for (size_t i = model->game_channel_slots.size(); i-- > 0;)
+    {
+        if (model->game_channel_slots[i].dense_index == -1)
+            model->free_game_channel_slots.push_back(checked_cast<uint32_t>(i));
+    }
+    for (const auto &channel : displaced)
+        multitrack_model_add_game_channel(model, channel);
+
+    //tracks restoring their state can bind before the host restored its channels
+    std::fill(model->assigned_daw_track_count.begin(), model->assigned_daw_track_count.end(), 0);
+    for (const auto &daw_channel : model->daw_channels)
+    {
+        int index = multitrack_model_find_game_channel(model, daw_channel.assigned_game_channel_id);
+        if (index != -1)
+            model->assigned_daw_track_count[index]++;
+    }
+}
+
+Daw_Channel *multitrack_model_find_daw_channel(MuliTrack_Model *model, uint32_t daw_channel_id)
+{
+    auto it = model->daw_channel_indices.find(daw_channel_id);
+    if (it == model->daw_channel_indices.end())
+        return nullptr;
+    return &model->daw_channels[it->second];
+}
+
+void multitrack_model_add_daw_channel(MuliTrack_Model *model, uint32_t daw_channel_id)
+{
+    auto [it, is_new] = model->daw_channel_indices.emplace(daw_channel_id, checked_cast<uint32_t>(model->daw_channels.size()));
+    assert(is_new);
+    if (!is_new)
+        return;
+    model->daw_channels.push_back(Daw_Channel { .id = daw_channel_id, .assigned_game_channel_id = -1, .name = {} });
+}
+
+//the last daw channel takes the place of the removed one
+void multitrack_model_remove_daw_channel(MuliTrack_Model *model, uint32_t daw_channel_id)
+{
+    auto it = model->daw_channel_indices.find(daw_channel_id);
+    assert(it != model->daw_channel_indices.end());
+    if (it == model->daw_channel_indices.end())
+        return;
+    multitrack_model_bind(model, daw_channel_id, -1);
+    uint32_t index = it->second;
+    model->daw_channel_indices.erase(it);
+    if (index != model->daw_channels.size() - 1)
+    {
+        model->daw_channels[index] = model->daw_channels.back();
+        model->daw_channel_indices[model->daw_channels[index].id] = index;
+    }
+    model->daw_channels.pop_back();
+}
+
+void multitrack_model_bind(MuliTrack_Model *model, uint32_t daw_channel_id, int64_t game_channel_id)
+{
+    Daw_Channel *daw_channel = multitrack_model_find_daw_channel(model, daw_channel_id);
+    assert(daw_channel);
+    if (!daw_channel)
+        return;
+    int previous_index = multitrack_model_find_game_channel(model, daw_channel->assigned_game_channel_id);
+    if (previous_index != -1)
+        model->assigned_daw_track_count[previous_index]--;
+    daw_channel->assigned_game_channel_id = game_channel_id;
+    int index = multitrack_model_find_game_channel(model, game_channel_id);
+    if (index != -1)
+        model->assigned_daw_track_count[index]++;
+}
+
+static void write_varint(std::vector<uint8_t> *out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out->push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<uint8_t>(value));
+}
+
+static void write_float(std::vector<uint8_t> *out, float value)
+{
+    uint8_t bytes[sizeof(float)];
+    std::memcpy(bytes, &value, sizeof(float));
+    out->insert(out->end(), bytes, bytes + sizeof(float));
+}
+
+struct Channel_List_Encoder
+{
+    //the views point into the channels being encoded
+    std::unordered_map<std::string_view, uint32_t> name_indices;
+    std::vector<uint8_t> names;
+    std::vector<uint8_t> entries;
+    uint32_t previous_id;
+};
+
+static void channel_list_encode_id(Channel_List_Encoder *encoder, uint32_t id)
+{
+    //zigzag, so that a step back stays short too
+    int64_t difference = static_cast<int64_t>(id) - static_cast<int64_t>(encoder->previous_id);
+    write_varint(&encoder->entries, (static_cast<uint64_t>(difference) << 1) ^ static_cast<uint64_t>(difference >> 63));
+    encoder->previous_id = id;
+}
+
+static void channel_list_encode_channel(Channel_List_Encoder *encoder, const Game_Channel &channel)
+{
+    channel_list_encode_id(encoder, channel.id);
+    std::string_view name { channel.name, strnlen(channel.name, sizeof(channel.name)) };
+    auto [it, is_new] = encoder->name_indices.emplace(name, checked_cast<uint32_t>(encoder->name_indices.size()));
+    if (is_new)
+    {
+        write_varint(&encoder->names, name.size());
+        encoder->names.insert(encoder->names.end(), name.begin(), name.end());
+    }
+    write_varint(&encoder->entries, it->second);
+    write_float(&encoder->entries, channel.min_freq);
+    write_float(&encoder->entries, channel.max_freq);
+}
+
+//the name count, the names, the entry count then the entries
+static std::vector<uint8_t> channel_list_encoder_finish(Channel_List_Encoder *encoder, size_t entry_count)
+{
+    std::vector<uint8_t> out;
+    out.reserve(encoder->names.size() + encoder->entries.size() + 20);
+    write_varint(&out, encoder->name_indices.size());
+    out.insert(out.end(), encoder->names.begin(), encoder->names.end());
+    write_varint(&out, entry_count);
+    out.insert(out.end(), encoder->entries.begin(), encoder->entries.end());
+    return out;
+}
+
+std::vector<uint8_t> channel_list_encode(const std::vector<Game_Channel> &channels)
+{
+    Channel_List_Encoder encoder = {};
+    for (const auto &channel : channels)
+        channel_list_encode_channel(&encoder, channel);
+    return channel_list_encoder_finish(&encoder, channels.size());
+}
+
+std::vector<uint8_t> channel_list_ops_encode(const std::vector<Channel_List_Op> &ops)
+{
+    Channel_List_Encoder encoder = {};
+    for (const auto &op : ops)
+    {
+        write_varint(&encoder.entries, op.type);
+        write_varint(&encoder.entries, op.index);
+        //a remove only needs the id
+        if (op.type == Channel_List_Remove)
+            channel_list_encode_id(&encoder, op.channel.id);
+        else
+            channel_list_encode_channel(&encoder, op.channel);
+    }
+    return channel_list_encoder_finish(&encoder, ops.size());
+}
+
+struct Channel_List_Decoder
+{
+    const uint8_t *position;
+    const uint8_t *end;
+    std::vector<std::string_view> names;
+    uint32_t previous_id;
+};
+
+static bool read_varint(Channel_List_Decoder *decoder, uint64_t *out)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (decoder->position == decoder->end)
+            return false;
+        uint8_t byte = *decoder->position++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *out = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_float(Channel_List_Decoder *decoder, float *out)
+{
+    if (decoder->end - decoder->position < static_cast<ptrdiff_t>(sizeof(float)))
+        return false;
+    std::memcpy(out, decoder->position, sizeof(float));
+    decoder->position += sizeof(float);
+    return true;
+}
+
+//the names, then the entry count, which can't be more than the bytes left
+static bool channel_list_decoder_start(Channel_List_Decoder *decoder, size_t *out_entry_count)
+{
+    uint64_t name_count;
+    if (!read_varint(decoder, &name_count) || name_count > static_cast<uint64_t>(decoder->end - decoder->position))
+        return false;
+    decoder->names.reserve(checked_cast<size_t>(name_count));
+    for (uint64_t i = 0; i < name_count; i++)
+    {
+        uint64_t length;
+        if (!read_varint(decoder, &length) || length > static_cast<uint64_t>(decoder->end - decoder->position))
+            return false;
+        decoder->names.emplace_back(reinterpret_cast<const char*>(decoder->position), checked_cast<size_t>(length));
+        decoder->position += length;
+    }
+    uint64_t entry_count;
+    if (!read_varint(decoder, &entry_count) || entry_count > static_cast<uint64_t>(decoder->end - decoder->position))
+        return false;
+    *out_entry_count = checked_cast<size_t>(entry_count);
+    return true;
+}
+
+static bool channel_list_decode_id(Channel_List_Decoder *decoder, uint32_t *out)
+{
+    uint64_t zigzag;
+    if (!read_varint(decoder, &zigzag))
+        return false;
+    int64_t difference = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+    int64_t id = static_cast<int64_t>(decoder->previous_id) + difference;
+    if (id < 0 || id > static_cast<int64_t>(UINT32_MAX))
+        return false;
+    decoder->previous_id = static_cast<uint32_t>(id);
+    *out = decoder->previous_id;
+    return true;
+}
+
+static bool channel_list_decode_channel(Channel_List_Decoder *decoder, Game_Channel *out)
+{
+    *out = {};
+    uint64_t name_index;
+    if (!channel_list_decode_id(decoder, &out->id)
+        || !read_varint(decoder, &name_index)
+        || name_index >= decoder->names.size()
+        || !read_float(decoder, &out->min_freq)
+        || !read_float(decoder, &out->max_freq))
+        return false;
+    auto name = decoder->names[checked_cast<size_t>(name_index)];
+    std::memcpy(out->name, name.data(), std::min(name.size(), sizeof(out->name) - 1));
+    return true;
+}
+
+bool channel_list_decode(const uint8_t *data, size_t size, std::vector<Game_Channel> *out)
+{
+    Channel_List_Decoder decoder = { .position = data, .end = data + size, .names = {}, .previous_id = 0 };
+    size_t entry_count;
+    if (!channel_list_decoder_start(&decoder, &entry_count))
+        return false;
+    std::vector<Game_Channel> channels(entry_count);
+    for (auto &channel : channels)
+    {
+        if (!channel_list_decode_channel(&decoder, &channel))
+            return false;
+    }
+    *out = std::move(channels);
+    return true;
+}
+
+bool channel_list_ops_decode(const uint8_t *data, size_t size, std::vector<Channel_List_Op> *out)
+{
+    Channel_List_Decoder decoder = { .position = data, .end = data + size, .names = {}, .previous_id = 0 };
+    size_t entry_count;
+    if (!channel_list_decoder_start(&decoder, &entry_count))
+        return false;
+    std::vector<Channel_List_Op> ops(entry_count);
+    for (auto &op : ops)
+    {
+        uint64_t type, index;
+        if (!read_varint(&decoder, &type) || !read_varint(&decoder, &index) || type > Channel_List_Update || index > UINT32_MAX)
+            return false;
+        op = { .type = static_cast<Channel_List_Op_Type>(type), .index = static_cast<uint32_t>(index), .channel = {} };
+        bool is_decoded = op.type == Channel_List_Remove
+            ? channel_list_decode_id(&decoder, &op.channel.id)
+            : channel_list_decode_channel(&decoder, &op.channel);
+        if (!is_decoded)
+            return false;
+    }
+    *out = std::move(ops);
+    return true;
+}
+
+static constexpr char dsp_batch_prefix[] = "dsp_batch ";
+
+static uint32_t dsp_batch_bucket(uint32_t game_channel_id, uint32_t bucket_count)
+{
+    return (game_channel_id * 2654435761u) & (bucket_count - 1);
+}
+
+juce::String dsp_batch_message(const std::vector<DSP_Batch_Entry> &entries, int64_t apply_at_sample)
+{
+    DSP_Batch_Header header = { checked_cast<uint32_t>(entries.size()), 1, apply_at_sample };
+    while (header.bucket_count < header.entry_count * 2)
+        header.bucket_count *= 2;
+
+    //entry index + 1, 0 when empty
+    std::vector<uint32_t> buckets(header.bucket_count, 0);
+    for (uint32_t i = 0; i < header.entry_count; i++)
+    {
+        uint32_t bucket = dsp_batch_bucket(entries[i].game_channel_id, header.bucket_count);
+        while (buckets[bucket] != 0)
+            bucket = (bucket + 1) & (header.bucket_count - 1);
+        buckets[bucket] = i + 1;
+    }
+
+    juce::MemoryBlock blob;
+    blob.append(&header, sizeof(header));
+    blob.append(buckets.data(), buckets.size() * sizeof(uint32_t));
+    blob.append(entries.data(), entries.size() * sizeof(DSP_Batch_Entry));
+    return juce::String(dsp_batch_prefix) + juce::String::toHexString(blob.getData(), checked_cast<int>(blob.getSize()), 0);
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool hex_decode_at(const char *hex, size_t hex_length, size_t byte_offset, void *out, size_t size)
+{
+    if ((byte_offset + size) * 2 > hex_length)
+        return false;
+    auto *bytes = static_cast<uint8_t*>(out);
+    const char *at = hex + byte_offset * 2;
+    for (size_t i = 0; i < size; i++)
+    {
+        int high = hex_digit(at[i * 2]);
+        int low = hex_digit(at[i * 2 + 1]);
+        if (high < 0 || low < 0)
+            return false;
+        bytes[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return true;
+}
+
+bool dsp_batch_find(const juce::String &message, uint32_t game_channel_id, Scheduled_DSP_State *out)
+{
+    const char *text = message.toRawUTF8();
+    size_t length = message.getNumBytesAsUTF8();
+    size_t prefix_length = sizeof(dsp_batch_prefix) - 1;
+    if (length < prefix_length || std::memcmp(text, dsp_batch_prefix, prefix_length) != 0)
+        return false;
+    const char *hex = text + prefix_length;
+    size_t hex_length = length - prefix_length;
+
+    DSP_Batch_Header header;
+    if (!hex_decode_at(hex, hex_length, 0, &header, sizeof(header)))
+        return false;
+    if (header.bucket_count == 0 || (header.bucket_count & (header.bucket_count - 1)) != 0)
+        return false;
+
+    size_t buckets_offset = sizeof(header);
+    size_t entries_offset = buckets_offset + header.bucket_count * sizeof(uint32_t);
+    uint32_t bucket = dsp_batch_bucket(game_channel_id, header.bucket_count);
+    for (uint32_t probe = 0; probe < header.bucket_count; probe++)
+    {
+        uint32_t entry_index;
+        if (!hex_decode_at(hex, hex_length, buckets_offset + bucket * sizeof(uint32_t), &entry_index, sizeof(entry_index)))
+            return false;
+        if (entry_index == 0 || entry_index > header.entry_count)
+            return false;
+        DSP_Batch_Entry entry;
+        if (!hex_decode_at(hex, hex_length, entries_offset + (entry_index - 1) * sizeof(DSP_Batch_Entry), &entry, sizeof(entry)))
+            return false;
+        if (entry.game_channel_id == game_channel_id)
+        {
+            *out = { .dsp = entry.dsp, .apply_at_sample = header.apply_at_sample, .params = entry.params };
+            return true;
+        }
+        bucket = (bucket + 1) & (header.bucket_count - 1);
+    }
+    return false;
+}
+
+int64_t playhead_sample_position(juce::AudioPlayHead *play_head)
+{
+    if (!play_head)
+        return -1;
+    auto position = play_head->getPosition();
+    if (!position || !position->getIsPlaying())
+        return -1;
+    auto time_in_samples = position->getTimeInSamples();
+    if (!time_in_samples)
+        return -1;
+    return *time_in_samples;
+}
+
 bool equal_double(double a, double b, double theta)
 {
     return std::abs(a - b) < theta;
@@ -139,3 +821,113 @@ int64_t string_to(juce::String string)
 {
     return string.getLargeIntValue();
 }
+
+Stats stats_init(std::vector<std::string> bin_names)
+{
+    assert(bin_names.size() <= stats_max_bins);
+    Stats stats = {
+        .bin_names = std::move(bin_names),
+        .prefixes = { Stats_Prefix {} }
+    };
+    return stats;
+}
+
+void stats_begin_session(Stats *stats)
+{
+    assert(!stats->prefixes.empty());
+    stats->prefixes.push_back(stats->prefixes.back());
+}
+
+void stats_add_result(Stats *stats, uint32_t bin, bool is_correct, bool is_answered, float error, float response_time_ms)
+{
+    assert(bin < stats->bin_names.size());
+    //results without a session are put in a new one
+    if (stats->prefixes.size() == 1)
+        stats_begin_session(stats);
+    Stats_Bin &totals = stats->prefixes.back().bins[bin];
+    totals.count++;
+    if (is_correct)
+        totals.correct++;
+    if (is_answered)
+    {
+        totals.answered++;
+        totals.total_error += error;
+    }
+    totals.total_response_time_ms += response_time_ms;
+    auto bucket = checked_cast<uint32_t>(std::clamp(int(response_time_ms / stats_response_time_bucket_ms), 0, int(stats_response_time_buckets) - 1));
+    totals.response_time_histogram[bucket]++;
+}
+
+uint32_t stats_session_count(const Stats *stats)
+{
+    return checked_cast<uint32_t>(stats->prefixes.size()) - 1;
+}
+
+Stats_Bin stats_query(const Stats *stats, uint32_t bin, uint32_t last_session_count)
+{
+    assert(bin < stats->bin_names.size());
+    uint32_t session_count = stats_session_count(stats);
+    if (last_session_count == 0 || last_session_count > session_count)
+        last_session_count = session_count;
+
+    const Stats_Bin &last = stats->prefixes.back().bins[bin];
+    const Stats_Bin &first = stats->prefixes[session_count - last_session_count].bins[bin];
+    Stats_Bin result = {
+        .count = last.count - first.count,
+        .correct = last.correct - first.correct,
+        .answered = last.answered - first.answered,
+        .total_error = last.total_error - first.total_error,
+        .total_response_time_ms = last.total_response_time_ms - first.total_response_time_ms
+    };
+    for (uint32_t i = 0; i < stats_response_time_buckets; i++)
+        result.response_time_histogram[i] = last.response_time_histogram[i] - first.response_time_histogram[i];
+    return result;
+}
+
+float stats_bin_accuracy(const Stats_Bin &bin)
+{
+    if (bin.count == 0)
+        return 0.0f;
+    return float(bin.correct) / float(bin.count);
+}
+
+float stats_bin_mean_error(const Stats_Bin &bin)
+{
+    if (bin.answered == 0)
+        return 0.0f;
+    return float(bin.total_error / bin.answered);
+}
+
+float stats_bin_response_time_percentile(const Stats_Bin &bin, float percentile)
+{
+    if (bin.count == 0)
+        return 0.0f;
+    auto threshold = uint32_t(std::ceil(percentile * float(bin.count)));
+    uint32_t cumulated = 0;
+    for (uint32_t i = 0; i < stats_response_time_buckets; i++)
+    {
+        cumulated += bin.response_time_histogram[i];
+        if (cumulated >= threshold)
+            return (float(i) + 0.5f) * stats_response_time_bucket_ms;
+    }
+    return float(stats_response_time_buckets) * stats_response_time_bucket_ms;
+}
+
+uint32_t stats_octave_bin(uint32_t frequency)
+{
+    if (frequency <= stats_octave_min_frequency)
+        return 0;
+    auto octave = uint32_t(std::log2(float(frequency) / float(stats_octave_min_frequency)));
+    return std::min(octave, 9u);
+}
+
+std::vector<std::string> stats_octave_bin_names()
+{
+    std::vector<std::string> names{};
+    for (uint32_t octave = 0; octave < 10; octave++)
+    {
+        uint32_t low = stats_octave_min_frequency << octave;
+        names.push_back(std::to_string(low) + " - " + std::to_string(low * 2) + " Hz");
+    }
+    return names;
+}
@@ -6,6 +6,7 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <unordered_set>
 #undef NDEBUG
 #include <assert.h>
 
@@ -73,6 +74,36 @@ struct Channel_DSP_State {
     Compressor_DSP_State comp;
 };
 
+//the gain of the first eq band moving from start_gain_db to end_gain_db, interpolated by the audio thread.
+//the band's own gain is replaced while it runs, duration_ms is 0 when there is no ramp
+struct DSP_EQ_Gain_Ramp {
+    float start_gain_db;
+    float end_gain_db;
+    int duration_ms;
+};
+
+//what a track's chain is set from, computed by the host once per game channel
+//instead of by every track bound to it
+struct Channel_DSP_Params {
+    //the rate the coefficients are for, 0 when they weren't computed
+    double sample_rate;
+    float eq_coefficients[1][5];
+    bool is_compressor_on;
+    float threshold;
+    float ratio;
+    float attack;
+    float release;
+    float makeup_gain;
+    float gain_db;
+};
+
+//the playhead sample at which every track switches to the state together, -1 for right away
+struct Scheduled_DSP_State {
+    Channel_DSP_State dsp;
+    int64_t apply_at_sample;
+    Channel_DSP_Params params;
+};
+
 
 struct Audio_File
 {
@@ -91,6 +122,7 @@ struct Audio_File
 Channel_DSP_State ChannelDSP_on();
 Channel_DSP_State ChannelDSP_off();
 Channel_DSP_State ChannelDSP_gain_db(double gain_db);
+bool channel_dsp_equal(const Channel_DSP_State &a, const Channel_DSP_State &b);
 DSP_EQ_Band eq_band_peak(float frequency, float quality, float gain);
 
 
@@ -101,10 +133,20 @@ using Channel_DSP_Gain       = juce::dsp::Gain<float>;
 using Channel_DSP_Compressor = juce::dsp::Compressor<float>;
 using Channel_DSP_Chain = juce::dsp::ProcessorChain<Channel_DSP_FilterBand, Channel_DSP_Compressor, Channel_DSP_Gain, Channel_DSP_Gain>;
 
+//installed_under_lock runs in the same critical section as the new coefficients, before the audio thread sees them
 void channel_dsp_update_chain(Channel_DSP_Chain *dsp_chain,
                               Channel_DSP_State state,
                               juce::CriticalSection *lock,
-                              double sample_rate);
+                              double sample_rate,
+                              const std::function<void()> &installed_under_lock = {});
+
+//audio thread versions, nothing is allocated.
+//every band is written as a normalized biquad (b0 b1 b2 a1 a2), so the filter order never changes
+void make_biquad_coefficients(DSP_EQ_Band band, double sample_rate, float out_coefficients[5]);
+void channel_dsp_prepare_realtime(Channel_DSP_Chain *dsp_chain, const juce::dsp::ProcessSpec &spec, const Channel_DSP_State &state);
+void channel_dsp_update_chain_realtime(Channel_DSP_Chain *dsp_chain, const Channel_DSP_State &state, double sample_rate);
+Channel_DSP_Params channel_dsp_make_params(const Channel_DSP_State &state, double sample_rate);
+void channel_dsp_apply_params(Channel_DSP_Chain *dsp_chain, const Channel_DSP_Params &params);
 
 //------------------------------------------------------------------------
 struct Channel_DSP_Callback : public juce::AudioSource
@@ -123,15 +165,48 @@ struct Channel_DSP_Callback : public juce::AudioSource
 
         juce::ScopedNoDenormals noDenormals;
 
+        juce::dsp::AudioBlock<float> block(*bufferToFill.buffer, (size_t) bufferToFill.startSample);
+        juce::ScopedLock processLock (lock);
+        if (eq_ramp.duration_ms <= 0)
         {
-            juce::dsp::AudioBlock<float> block(*bufferToFill.buffer, (size_t) bufferToFill.startSample);
-            juce::dsp::ProcessContextReplacing<float> context (block);
-            juce::ScopedLock processLock (lock);
-            normalization_gain.process(context);
-            dsp_chain.process(context);
-            master_gain.process(context);
+            process_block(block);
+            return;
+        }
+
+        //the coefficients follow the ramp every sub block
+        int64_t ramp_length = static_cast<int64_t>(eq_ramp.duration_ms * sample_rate / 1000.0);
+        for (size_t offset = 0; offset < block.getNumSamples(); offset += eq_ramp_sub_block_size)
+        {
+            float t = ramp_length > 0 ? std::min(1.0f, float(eq_ramp_position) / float(ramp_length)) : 1.0f;
+            set_eq_ramp_coefficients(t);
+            size_t length = std::min(eq_ramp_sub_block_size, block.getNumSamples() - offset);
+            process_block(block.getSubBlock(offset, length));
+            eq_ramp_position += static_cast<int64_t>(length);
+        }
+        if (eq_ramp_position >= ramp_length)
+        {
+            set_eq_ramp_coefficients(1.0f);
+            eq_ramp.duration_ms = 0;
         }
     }
+
+    void process_block(juce::dsp::AudioBlock<float> block)
+    {
+        juce::dsp::ProcessContextReplacing<float> context (block);
+        normalization_gain.process(context);
+        dsp_chain.process(context);
+        master_gain.process(context);
+    }
+
+    //audio thread, nothing is allocated
+    void set_eq_ramp_coefficients(float t)
+    {
+        DSP_EQ_Band band = eq_ramp_band;
+        band.gain = juce::Decibels::decibelsToGain(eq_ramp.start_gain_db + (eq_ramp.end_gain_db - eq_ramp.start_gain_db) * t);
+        auto &raw_coefficients = dsp_chain.get<0>().state->coefficients;
+        assert(raw_coefficients.size() == 5);
+        make_biquad_coefficients(band, sample_rate, raw_coefficients.begin());
+    }
     
     void prepareToPlay (int blockSize, double sampleRate) override
     {
@@ -154,11 +229,26 @@ struct Channel_DSP_Callback : public juce::AudioSource
         normalization_gain.setGainLinear(normalization_level);
     }
 
-    void push_new_dsp_state(Channel_DSP_State new_state)
+    //one push for the whole ramp, the audio thread does the rest
+    void push_new_dsp_state(Channel_DSP_State new_state, DSP_EQ_Gain_Ramp ramp = {})
     {
         state = new_state;
-        if(sample_rate != -1.0)
-            channel_dsp_update_chain(&dsp_chain, state, &lock, sample_rate);
+        if (sample_rate == -1.0)
+        {
+            juce::ScopedLock processLock (lock);
+            eq_ramp = {};
+            eq_ramp_band = state.eq_bands[0];
+            eq_ramp_position = 0;
+            return;
+        }
+        //with the coefficients, so that no block runs at the band's own gain nor ramps the previous band
+        channel_dsp_update_chain(&dsp_chain, state, &lock, sample_rate, [&] {
+            //a first order band, or no band at all, has no gain to ramp and fewer coefficients
+            bool is_second_order = dsp_chain.get<0>().state->coefficients.size() == 5;
+            eq_ramp = is_second_order ? ramp : DSP_EQ_Gain_Ramp {};
+            eq_ramp_band = state.eq_bands[0];
+            eq_ramp_position = 0;
+        });
     }
 
     void push_master_volume_db(double master_volume_db)
@@ -174,6 +264,12 @@ struct Channel_DSP_Callback : public juce::AudioSource
     double sample_rate = -1.0;
     juce::CriticalSection lock;
     juce::AudioSource *input_source;
+
+    static constexpr size_t eq_ramp_sub_block_size = 32;
+    //under the lock
+    DSP_EQ_Gain_Ramp eq_ramp = {};
+    DSP_EQ_Band eq_ramp_band = {};
+    int64_t eq_ramp_position = 0;
 };
 
 struct Game_Channel
@@ -203,38 +299,57 @@ enum MultiTrack_Observers_ID : int
     MultiTrack_Observers_Main_Menu
 };
 
+//a game channel id is a slot handle, the slot index in the low bits and the slot generation above,
+//so that the id of a deleted channel doesn't find the channel which reuses its slot
+static constexpr uint32_t game_channel_index_bits = 16;
+static constexpr uint32_t game_channel_index_mask = (1u << game_channel_index_bits) - 1;
+
+struct Game_Channel_Slot
+{
+    uint32_t generation;
+    //into game_channels, -1 when the slot is free
+    int32_t dense_index;
+};
+
 struct MuliTrack_Model
 {
-    std::unordered_map<uint32_t, Game_Channel> game_channels;
-    std::vector<int> order;
-    std::unordered_map<int, Daw_Channel> daw_channels;
+    //dense, in the order they are displayed and played
+    std::vector<Game_Channel> game_channels;
+    //how many daw channels are bound to each game channel, kept up to date on bind, unbind and delete
+    std::vector<int> assigned_daw_track_count;
+    std::vector<Game_Channel_Slot> game_channel_slots;
+    std::vector<uint32_t> free_game_channel_slots;
+    //dense, the ids come from the tracks
+    std::vector<Daw_Channel> daw_channels;
+    std::unordered_map<uint32_t, uint32_t> daw_channel_indices;
     std::unordered_map<int, multitrack_observer_t> observers;
-    std::unordered_map<int, int> assigned_daw_track_count;
 };
 
+//-1 when the id doesn't name a live channel
+int multitrack_model_find_game_channel(const MuliTrack_Model *model, int64_t game_channel_id);
+uint32_t multitrack_model_add_game_channel(MuliTrack_Model *model, Game_Channel channel);
+void multitrack_model_remove_game_channel(MuliTrack_Model *model, uint32_t game_channel_id);
+//the saved channels keep their ids, a slot taken twice by an older save gives the second channel a new id
+void multitrack_model_set_game_channels(MuliTrack_Model *model, const std::vector<Game_Channel> &channels);
+Daw_Channel *multitrack_model_find_daw_channel(MuliTrack_Model *model, uint32_t daw_channel_id);
+void multitrack_model_add_daw_channel(MuliTrack_Model *model, uint32_t daw_channel_id);
+void multitrack_model_remove_daw_channel(MuliTrack_Model *model, uint32_t daw_channel_id);
+//-1 unbinds
+void multitrack_model_bind(MuliTrack_Model *model, uint32_t daw_channel_id, int64_t game_channel_id);
+
 #if 0
 
 static void debug_multitrack_model(MuliTrack_Model *model)
 {    
-    assert(model->game_channels.size() == model->order.size());
-
     DBG("Game Channels :");
-    for (auto& [id, game_channel] : model->game_channels)
+    for (size_t i = 0; i < model->game_channels.size(); i++)
     {
-        DBG(game_channel.name << ", " << game_channel.id % 100);
-        DBG("-----> bound to " << model->assigned_daw_track_count.at(id) << " tracks");
+        DBG(model->game_channels[i].name << ", " << model->game_channels[i].id % 100);
+        DBG("-----> bound to " << model->assigned_daw_track_count[i] << " tracks");
     }
-    assert(model->game_channels.size() == model->order.size());
-
-    DBG("Order");
-    for (auto channel_id : model->order)
-    {
-        DBG(model->game_channels.at(channel_id).name);
-    }
-    assert(model->game_channels.size() == model->order.size());
     
     DBG("Daw Channels :");
-    for (auto& [id, daw_channel] : model->daw_channels)
+    for (const auto& daw_channel : model->daw_channels)
     {
         DBG(daw_channel.name << ", " << daw_channel.id % 100);
         if (daw_channel.assigned_game_channel_id == -1)
@@ -243,9 +358,9 @@ static void debug_multitrack_model(MuliTrack_Model *model)
         }
         else
         {
-            auto game_channel_it = model->game_channels.find(checked_cast<uint32_t>(daw_channel.assigned_game_channel_id));
-            if(game_channel_it != model->game_channels.end())
-                DBG("-----> " << game_channel_it->second.name << ", " << daw_channel.assigned_game_channel_id % 100);
+            int game_channel_index = multitrack_model_find_game_channel(model, daw_channel.assigned_game_channel_id);
+            if(game_channel_index != -1)
+                DBG("-----> " << model->game_channels[game_channel_index].name << ", " << daw_channel.assigned_game_channel_id % 100);
             else 
                 DBG("-----> incorrect assignment : " << daw_channel.assigned_game_channel_id % 100);
         }
@@ -257,27 +372,12 @@ static void debug_multitrack_model(MuliTrack_Model *model)
 
 static void multitrack_model_broadcast_change(MuliTrack_Model *model, int observer_id_to_skip = -1)
 {       
-    assert(model->game_channels.size() == model->order.size());
-    model->assigned_daw_track_count.clear();
-    for (const auto& [id, game_channel] : model->game_channels)
-    {
-        model->assigned_daw_track_count.emplace(game_channel.id, 0);
-    }
-    for (const auto& [id, daw_channel] : model->daw_channels)
-    {
-        if (daw_channel.assigned_game_channel_id == -1) continue;
-        //TODO HACK, not sure if it is a proper fix
-        auto it = model->assigned_daw_track_count.find(checked_cast<uint32_t>(daw_channel.assigned_game_channel_id));
-        if(it == model->assigned_daw_track_count.end())
-            continue;
-        it->second++;
-    }
+    assert(model->game_channels.size() == model->assigned_daw_track_count.size());
     for (auto &[id, observer] : model->observers)
     {    
-        assert(model->game_channels.size() == model->order.size());
         if(id != observer_id_to_skip)
             observer(model);
-        assert(model->game_channels.size() == model->order.size());
+        assert(model->game_channels.size() == model->assigned_daw_track_count.size());
     }
 }
 
@@ -294,19 +394,100 @@ static void multitrack_model_remove_observer(MuliTrack_Model *model, int observe
     assert(count == 1);
 }
 
-struct Game_Channel_Broadcast_Message {
-    Game_Channel channels[256];
-    int channel_count;
+//the channel list is broadcast as versioned deltas, "channel_list_delta <session> <from version> <base64 ops>".
+//a track that missed a version asks for a full "channel_list <session> <version> <base64 channels>" snapshot
+enum Channel_List_Op_Type : uint32_t {
+    Channel_List_Insert = 0,
+    Channel_List_Remove,
+    Channel_List_Update
 };
 
+struct Channel_List_Op {
+    Channel_List_Op_Type type;
+    //insert position, the removes come first
+    uint32_t index;
+    Game_Channel channel;
+};
+
+bool game_channel_equal(const Game_Channel &a, const Game_Channel &b);
+//false when the channels which are kept changed order, a delta can't express that
+bool channel_list_diff(const std::vector<Game_Channel> &from, const std::vector<Game_Channel> &to, std::vector<Channel_List_Op> *out_ops);
+bool channel_list_apply(std::vector<Game_Channel> *list, const std::vector<Channel_List_Op> &ops);
+
+//the encoding of the channel lists and their deltas, in the messages and in the shared memory.
+//every distinct name is written once and the channels refer to it by index,
+//the ids are written as the difference with the previous one, a byte while they stay dense
+std::vector<uint8_t> channel_list_encode(const std::vector<Game_Channel> &channels);
+bool channel_list_decode(const uint8_t *data, size_t size, std::vector<Game_Channel> *out);
+std::vector<uint8_t> channel_list_ops_encode(const std::vector<Channel_List_Op> &ops);
+bool channel_list_ops_decode(const uint8_t *data, size_t size, std::vector<Channel_List_Op> *out);
+
+//every dsp state of one update in a single "dsp_batch <hex>" broadcast.
+//the blob is a header, a hash index of the game channel ids then the entries,
+//so a track only decodes the header, its bucket and its own entry
+struct DSP_Batch_Header {
+    uint32_t entry_count;
+    uint32_t bucket_count;
+    int64_t apply_at_sample;
+};
+
+struct DSP_Batch_Entry {
+    uint32_t game_channel_id;
+    Channel_DSP_State dsp;
+    Channel_DSP_Params params;
+};
+
+juce::String dsp_batch_message(const std::vector<DSP_Batch_Entry> &entries, int64_t apply_at_sample);
+bool dsp_batch_find(const juce::String &message, uint32_t game_channel_id, Scheduled_DSP_State *out);
+
+//-1 when the DAW isn't playing or doesn't tell
+int64_t playhead_sample_position(juce::AudioPlayHead *play_head);
+
 struct Settings{
     float difficulty;
 };
 
+//results are accumulated in fixed bins (octaves for the frequency game, fader positions for the mixer game...)
+//every session keeps the running totals of all the sessions before it, so that any range of sessions
+//is a subtraction of two prefixes, and adding a result only touches the current one
+static constexpr uint32_t stats_max_bins = 12;
+static constexpr uint32_t stats_response_time_buckets = 16;
+static constexpr float stats_response_time_bucket_ms = 250.0f;
+
+struct Stats_Bin {
+    uint32_t count;
+    uint32_t correct;
+    //the error is only meaningful for the answered questions
+    uint32_t answered;
+    double total_error;
+    double total_response_time_ms;
+    uint32_t response_time_histogram[stats_response_time_buckets];
+};
+
+struct Stats_Prefix {
+    Stats_Bin bins[stats_max_bins];
+};
+
 struct Stats {
-    int total_score;
+    std::vector<std::string> bin_names;
+    //prefixes[i] holds the totals of sessions [0, i), the last one is the running total
+    std::vector<Stats_Prefix> prefixes;
 };
 
+Stats stats_init(std::vector<std::string> bin_names);
+void stats_begin_session(Stats *stats);
+void stats_add_result(Stats *stats, uint32_t bin, bool is_correct, bool is_answered, float error, float response_time_ms);
+uint32_t stats_session_count(const Stats *stats);
+//last_session_count == 0 means all sessions
+Stats_Bin stats_query(const Stats *stats, uint32_t bin, uint32_t last_session_count);
+float stats_bin_accuracy(const Stats_Bin &bin);
+float stats_bin_mean_error(const Stats_Bin &bin);
+float stats_bin_response_time_percentile(const Stats_Bin &bin, float percentile);
+
+static constexpr uint32_t stats_octave_min_frequency = 20;
+uint32_t stats_octave_bin(uint32_t frequency);
+std::vector<std::string> stats_octave_bin_names();
+
 bool equal_double(double a, double b, double theta);
 size_t db_to_slider_pos(double db, const std::vector<double> &db_values);
 
@@ -106,6 +106,7 @@ public:
         label.setBounds(labelBounds);
         
         auto faderBounds = r;
+        meter_bounds = faderBounds.removeFromRight(6).reduced(0, 8);
         fader.setBounds(faderBounds);
     }
     
@@ -114,6 +115,28 @@ public:
         auto r = getLocalBounds();
         g.setColour(juce::Colours::white);
         g.drawRoundedRectangle(r.toFloat(), 5.0f, 2.0f);
+
+        if (has_level)
+        {
+            auto bar = meter_bounds.toFloat();
+            auto db_to_y = [&] (float db) {
+                return juce::jmap(juce::jlimit(-60.0f, 0.0f, db), -60.0f, 0.0f, bar.getBottom(), bar.getY());
+            };
+            g.setColour(juce::Colours::black);
+            g.fillRect(bar);
+            g.setColour(juce::Colours::green);
+            g.fillRect(bar.withTop(db_to_y(rms_db)));
+            g.setColour(peak_db > -0.1f ? juce::Colours::red : juce::Colours::yellow);
+            g.drawHorizontalLine(juce::roundToInt(db_to_y(peak_db)), bar.getX(), bar.getRight());
+        }
+    }
+
+    void set_level(float new_peak_db, float new_rms_db)
+    {
+        has_level = true;
+        peak_db = new_peak_db;
+        rms_db = new_rms_db;
+        repaint(meter_bounds);
     }
     
     void setTrackName(const juce::String& new_name)
@@ -156,6 +179,10 @@ private:
     juce::Label label;
     TextSlider fader;
     const std::vector<double> &db_values;
+    juce::Rectangle<int> meter_bounds;
+    bool has_level = false;
+    float peak_db = -100.0f;
+    float rms_db = -100.0f;
     //double targetValue;
     //double smoothing;
 };
@@ -677,4 +704,78 @@ public:
 
 private:
     std::vector<std::unique_ptr<juce::DrawableButton>> buttons;
-};
\ No newline at end of file
+};
+
+//one row per bin : accuracy, mean error and median response time over the chosen range of sessions
+class Stats_Table : public juce::Component
+{
+public:
+    Stats_Table(juce::String title, const Stats *stats_to_display, juce::String errorUnit)
+    : stats(stats_to_display),
+      error_unit(errorUnit)
+    {
+        title_label.setText(title, juce::dontSendNotification);
+        addAndMakeVisible(title_label);
+
+        range_box.addItem("All sessions", 1);
+        range_box.addItem("Last session", 2);
+        range_box.addItem("Last 5 sessions", 3);
+        range_box.addItem("Last 20 sessions", 4);
+        range_box.setSelectedId(1, juce::dontSendNotification);
+        range_box.onChange = [this] { repaint(); };
+        addAndMakeVisible(range_box);
+    }
+
+    void resized() override
+    {
+        auto r = getLocalBounds();
+        auto top = r.removeFromTop(24);
+        range_box.setBounds(top.removeFromRight(150));
+        title_label.setBounds(top);
+    }
+
+    void paint(juce::Graphics &g) override
+    {
+        uint32_t last_session_count = 0;
+        switch (range_box.getSelectedId())
+        {
+            case 2 : last_session_count = 1; break;
+            case 3 : last_session_count = 5; break;
+            case 4 : last_session_count = 20; break;
+        }
+
+        auto r = getLocalBounds().withTrimmedTop(28);
+        auto row_height = 18;
+        auto draw_row = [&] (juce::String name, juce::String accuracy, juce::String error, juce::String response_time) {
+            auto row = r.removeFromTop(row_height);
+            auto column_width = row.getWidth() / 4;
+            g.drawText(name, row.removeFromLeft(column_width), juce::Justification::centredLeft);
+            g.drawText(accuracy, row.removeFromLeft(column_width), juce::Justification::centred);
+            g.drawText(error, row.removeFromLeft(column_width), juce::Justification::centred);
+            g.drawText(response_time, row, juce::Justification::centred);
+        };
+
+        g.setColour(juce::Colours::grey);
+        draw_row("", "Accuracy", "Mean error", "Median time");
+        g.setColour(juce::Colours::white);
+        for (uint32_t bin_idx = 0; bin_idx < stats->bin_names.size(); bin_idx++)
+        {
+            Stats_Bin bin = stats_query(stats, bin_idx, last_session_count);
+            if (bin.count == 0)
+            {
+                draw_row(stats->bin_names[bin_idx], "-", "-", "-");
+                continue;
+            }
+            draw_row(stats->bin_names[bin_idx],
+                     juce::String(stats_bin_accuracy(bin) * 100.0f, 0) + " %",
+                     juce::String(stats_bin_mean_error(bin), 2) + " " + error_unit,
+                     juce::String(stats_bin_response_time_percentile(bin, 0.5f), 0) + " ms");
+        }
+    }
+
+private:
+    const Stats *stats;
+    juce::String error_unit;
+    juce::Label title_label;
+    juce::ComboBox range_box;
+};
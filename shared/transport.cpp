@@ -0,0 +1,580 @@
+#include "pch.h"
+#include "shared.h"
+#include "transport.h"
+#include <chrono>
+
+//shared by the processes of the machine, unlike the wall clock it doesn't jump
+static int64_t transport_now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if JUCE_LINUX || JUCE_MAC
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//bumped whenever the layout of Transport_Block changes, a segment left by an older build is then recreated
+static constexpr uint32_t transport_ready_magic = 0x4d540007;
+
+static std::string transport_segment_name()
+{
+#if MIXTRAINER_HEADLESS
+    //the bench runs its own host and tracks, it mustn't clear the slots or pop the commands of a DAW session
+    return "/mixtrainer_transport_" + std::to_string(getuid()) + "_bench_" + std::to_string(getpid());
+#else
+    return "/mixtrainer_transport_" + std::to_string(getuid());
+#endif
+}
+
+static std::string transport_lock_path(const std::string &name)
+{
+    return "/tmp" + name + ".lock";
+}
+
+//serializes the hosts creating, replacing and unlinking the segment, so that two of them can't each end up with their own
+static int transport_lock(const std::string &name, bool should_wait)
+{
+    int fd = open(transport_lock_path(name).c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd == -1)
+        return -1;
+    if (flock(fd, should_wait ? LOCK_EX : LOCK_EX | LOCK_NB) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void transport_unlock(int lock_fd)
+{
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+}
+
+//ftruncate zero filled the block : the positions are 0, the dsp and meter slots empty, the channel list too.
+//only the ring's sequences start elsewhere, the other pages stay unbacked until something is written to them
+static void transport_init_block(Transport_Block *block)
+{
+    for (uint32_t i = 0; i < transport_command_capacity; i++)
+        block->commands[i].sequence.store(i, std::memory_order_relaxed);
+    block->host_heartbeat_ms.store(transport_now_ms(), std::memory_order_relaxed);
+    block->ready.store(transport_ready_magic, std::memory_order_release);
+}
+
+//nullptr when the segment is missing, or too small to be a Transport_Block
+static Transport_Block *transport_map_existing(const std::string &name, int *fd_out)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd == -1)
+        return nullptr;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Transport_Block))
+    {
+        close(fd);
+        return nullptr;
+    }
+    void *address = mmap(nullptr, sizeof(Transport_Block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        close(fd);
+        return nullptr;
+    }
+    *fd_out = fd;
+    return static_cast<Transport_Block*>(address);
+}
+
+static void transport_unmap(Transport_Block *block, int fd)
+{
+    munmap(block, sizeof(Transport_Block));
+    close(fd);
+}
+
+static std::unique_ptr<Transport> transport_make(Transport_Block *block, int fd, bool is_owner)
+{
+    return std::make_unique<Transport>(Transport {
+        .block = block,
+        .file_descriptor = fd,
+        .is_owner = is_owner,
+        .stalled_position = std::numeric_limits<uint64_t>::max(),
+        .stalled_since_ms = 0
+    });
+}
+
+static std::unique_ptr<Transport> transport_attach(const std::string &name)
+{
+    int fd;
+    Transport_Block *block = transport_map_existing(name, &fd);
+    if (!block)
+        return nullptr;
+    if (block->ready.load(std::memory_order_acquire) != transport_ready_magic
+        || block->is_retired.load(std::memory_order_acquire))
+    {
+        transport_unmap(block, fd);
+        return nullptr;
+    }
+    return transport_make(block, fd, false);
+}
+
+static std::unique_ptr<Transport> transport_create(const std::string &name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1)
+        return nullptr;
+    if (ftruncate(fd, sizeof(Transport_Block)) != 0)
+    {
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void *address = mmap(nullptr, sizeof(Transport_Block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    auto *block = static_cast<Transport_Block*>(address);
+    transport_init_block(block);
+    return transport_make(block, fd, true);
+}
+
+static bool transport_block_is_alive(Transport_Block *block)
+{
+    return !block->is_retired.load(std::memory_order_acquire)
+        && transport_now_ms() - block->host_heartbeat_ms.load(std::memory_order_relaxed) < transport_host_timeout_ms;
+}
+
+std::unique_ptr<Transport> transport_open(Transport_Role role)
+{
+    auto name = transport_segment_name();
+    if (role == Transport_Role_Track)
+        return transport_attach(name);
+
+    //another host is in the middle of it, the caller retries on its next tick
+    int lock_fd = transport_lock(name, false);
+    if (lock_fd == -1)
+        return nullptr;
+
+    std::unique_ptr<Transport> transport;
+    int fd;
+    if (Transport_Block *block = transport_map_existing(name, &fd))
+    {
+        bool is_current = block->ready.load(std::memory_order_acquire) == transport_ready_magic;
+        if (is_current && transport_block_is_alive(block))
+        {
+            //a second host, it shares the segment of the first one but only reads and pops from it
+            transport = transport_make(block, fd, false);
+        }
+        else
+        {
+            //the host which created it is gone, a ring slot may be stuck, the tracks move to a new one.
+            //a segment of an older build has another layout, it can't be told anything
+            DBG("transport : replacing a shared memory segment without a live host");
+            if (is_current)
+                block->is_retired.store(1, std::memory_order_release);
+            transport_unmap(block, fd);
+            shm_unlink(name.c_str());
+        }
+    }
+    if (!transport)
+        transport = transport_create(name);
+
+    transport_unlock(lock_fd);
+    return transport;
+}
+
+void transport_close(Transport *transport)
+{
+    if (transport->is_owner)
+    {
+        //only if the name still points to this segment, another host may have replaced it in the meantime
+        auto name = transport_segment_name();
+        int lock_fd = transport_lock(name, true);
+        struct stat own_info, named_info;
+        int named_fd = shm_open(name.c_str(), O_RDONLY, 0600);
+        bool is_named = named_fd != -1 && fstat(named_fd, &named_info) == 0 && fstat(transport->file_descriptor, &own_info) == 0
+            && named_info.st_ino == own_info.st_ino;
+        if (named_fd != -1)
+            close(named_fd);
+        transport->block->is_retired.store(1, std::memory_order_release);
+        if (is_named)
+            shm_unlink(name.c_str());
+        if (lock_fd != -1)
+            transport_unlock(lock_fd);
+    }
+    transport_unmap(transport->block, transport->file_descriptor);
+    transport->block = nullptr;
+    transport->file_descriptor = -1;
+}
+
+#if MIXTRAINER_HEADLESS
+void transport_remove_private_segment()
+{
+    auto name = transport_segment_name();
+    shm_unlink(name.c_str());
+    unlink(transport_lock_path(name).c_str());
+}
+#endif
+
+#else
+
+std::unique_ptr<Transport> transport_open(Transport_Role role)
+{
+    juce::ignoreUnused(role);
+    return nullptr;
+}
+
+void transport_close(Transport *transport)
+{
+    juce::ignoreUnused(transport);
+    jassertfalse;
+}
+
+#if MIXTRAINER_HEADLESS
+void transport_remove_private_segment()
+{
+}
+#endif
+
+#endif
+
+bool transport_is_retired(Transport *transport)
+{
+    return transport->block->is_retired.load(std::memory_order_acquire) != 0;
+}
+
+void transport_host_heartbeat(Transport *transport)
+{
+    //a second host beating would keep the segment alive after its owner is gone, with no one publishing to it
+    if (!transport->is_owner)
+        return;
+    transport->block->host_heartbeat_ms.store(transport_now_ms(), std::memory_order_relaxed);
+}
+
+bool transport_is_host_alive(Transport *transport)
+{
+    return transport_block_is_alive(transport->block);
+}
+
+bool transport_push_command(Transport *transport, const Transport_Command &command)
+{
+    Transport_Block *block = transport->block;
+    uint64_t position = block->command_enqueue_position.load(std::memory_order_relaxed);
+    Transport_Command_Cell *cell;
+    for (;;)
+    {
+        cell = &block->commands[position & (transport_command_capacity - 1)];
+        uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int64_t difference = (int64_t)sequence - (int64_t)position;
+        if (difference == 0)
+        {
+            if (block->command_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        //full, the host isn't draining
+        else if (difference < 0)
+            return false;
+        else
+            position = block->command_enqueue_position.load(std::memory_order_relaxed);
+    }
+    cell->command = command;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+//a producer which dies between claiming a slot and filling it would block the ring for good,
+//every track would then fall back to the broadcast. the slot is skipped once it stayed unfilled for longer than a live producer takes
+static void transport_skip_stalled_command(Transport *transport, Transport_Command_Cell *cell, uint64_t position)
+{
+    int64_t now = transport_now_ms();
+    if (transport->stalled_position != position)
+    {
+        transport->stalled_position = position;
+        transport->stalled_since_ms = now;
+        return;
+    }
+    if (now - transport->stalled_since_ms < transport_stalled_command_timeout_ms)
+        return;
+
+    DBG("transport : skipping a command slot left unfilled by a producer");
+    //released as if it had been consumed, the producers of the next lap can use it
+    uint64_t expected = position;
+    if (transport->block->command_dequeue_position.compare_exchange_strong(expected, position + 1, std::memory_order_relaxed))
+        cell->sequence.store(position + transport_command_capacity, std::memory_order_release);
+    transport->stalled_position = std::numeric_limits<uint64_t>::max();
+}
+
+bool transport_pop_command(Transport *transport, Transport_Command *out)
+{
+    //one host is expected, but a second one loaded by mistake mustn't corrupt the ring
+    Transport_Block *block = transport->block;
+    uint64_t position = block->command_dequeue_position.load(std::memory_order_relaxed);
+    Transport_Command_Cell *cell;
+    for (;;)
+    {
+        cell = &block->commands[position & (transport_command_capacity - 1)];
+        uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int64_t difference = (int64_t)sequence - (int64_t)(position + 1);
+        if (difference == 0)
+        {
+            if (block->command_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            //empty, or claimed by a producer which didn't fill it yet
+            if (block->command_enqueue_position.load(std::memory_order_relaxed) > position)
+                transport_skip_stalled_command(transport, cell, position);
+            return false;
+        }
+        else
+            position = block->command_dequeue_position.load(std::memory_order_relaxed);
+    }
+    transport->stalled_position = std::numeric_limits<uint64_t>::max();
+    *out = cell->command;
+    cell->sequence.store(position + transport_command_capacity, std::memory_order_release);
+    return true;
+}
+
+static uint32_t transport_dsp_home_slot(uint32_t game_channel_id)
+{
+    return (game_channel_id * 2654435761u) & (transport_dsp_slot_count - 1);
+}
+
+void transport_publish_dsp(Transport *transport, uint32_t game_channel_id, const Scheduled_DSP_State &scheduled)
+{
+    if (!transport->is_owner)
+        return;
+    uint64_t key = (uint64_t)game_channel_id + 1;
+    uint32_t home = transport_dsp_home_slot(game_channel_id);
+    Transport_DSP_Slot *free_slot = nullptr;
+    for (uint32_t probe = 0; probe < transport_dsp_slot_count; probe++)
+    {
+        Transport_DSP_Slot *slot = &transport->block->dsp_slots[(home + probe) & (transport_dsp_slot_count - 1)];
+        uint64_t slot_key = slot->key.load(std::memory_order_relaxed);
+        if (slot_key == key)
+        {
+            seqlock_write(&slot->sequence, &slot->scheduled, scheduled);
+            return;
+        }
+        //the channel may still be further, past a removed slot
+        if (slot_key == transport_dsp_slot_removed && !free_slot)
+            free_slot = slot;
+        if (slot_key == 0)
+        {
+            if (!free_slot)
+                free_slot = slot;
+            break;
+        }
+    }
+    if (!free_slot)
+    {
+        jassertfalse;
+        return;
+    }
+    //the state is in place before the key makes the slot visible
+    seqlock_write(&free_slot->sequence, &free_slot->scheduled, scheduled);
+    free_slot->key.store(key, std::memory_order_release);
+}
+
+void transport_remove_dsp(Transport *transport, uint32_t game_channel_id)
+{
+    if (!transport->is_owner)
+        return;
+    uint64_t key = (uint64_t)game_channel_id + 1;
+    uint32_t home = transport_dsp_home_slot(game_channel_id);
+    for (uint32_t probe = 0; probe < transport_dsp_slot_count; probe++)
+    {
+        Transport_DSP_Slot *slot = &transport->block->dsp_slots[(home + probe) & (transport_dsp_slot_count - 1)];
+        uint64_t slot_key = slot->key.load(std::memory_order_relaxed);
+        if (slot_key == key)
+        {
+            //not 0, the readers would stop there before the channels placed after it
+            slot->key.store(transport_dsp_slot_removed, std::memory_order_release);
+            return;
+        }
+        if (slot_key == 0)
+            return;
+    }
+}
+
+//the slot may be removed and reused by another channel during the read, the key is checked again after it
+static bool transport_read_dsp_slot(Transport_DSP_Slot *slot, uint64_t key, Scheduled_DSP_State *out)
+{
+    if (!seqlock_read(&slot->sequence, &slot->scheduled, out))
+        return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->key.load(std::memory_order_relaxed) == key;
+}
+
+bool transport_read_dsp(Transport *transport, uint32_t game_channel_id, uint32_t *slot_hint, Scheduled_DSP_State *out)
+{
+    uint64_t key = (uint64_t)game_channel_id + 1;
+    Transport_Block *block = transport->block;
+    if (*slot_hint < transport_dsp_slot_count)
+    {
+        Transport_DSP_Slot *slot = &block->dsp_slots[*slot_hint];
+        if (slot->key.load(std::memory_order_acquire) == key)
+            return transport_read_dsp_slot(slot, key, out);
+    }
+
+    uint32_t home = transport_dsp_home_slot(game_channel_id);
+    for (uint32_t probe = 0; probe < transport_dsp_slot_count; probe++)
+    {
+        uint32_t index = (home + probe) & (transport_dsp_slot_count - 1);
+        Transport_DSP_Slot *slot = &block->dsp_slots[index];
+        uint64_t slot_key = slot->key.load(std::memory_order_acquire);
+        if (slot_key == key)
+        {
+            *slot_hint = index;
+            return transport_read_dsp_slot(slot, key, out);
+        }
+        //a removed slot doesn't end the probe
+        if (slot_key == 0)
+            return false;
+    }
+    return false;
+}
+
+//the same as seqlock_write and seqlock_read, for a variable amount of bytes
+void transport_publish_channel_list(Transport *transport, const std::vector<Game_Channel> &channels)
+{
+    if (!transport->is_owner)
+        return;
+    Transport_Block *block = transport->block;
+    auto encoded = channel_list_encode(channels);
+    if (encoded.size() > transport_channel_list_capacity)
+    {
+        //the tracks keep the previous list
+        jassertfalse;
+        return;
+    }
+
+    uint32_t start = block->channel_list_sequence.load(std::memory_order_relaxed);
+    block->channel_list_sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    block->channel_list_size = checked_cast<uint32_t>(encoded.size());
+    std::memcpy(block->channel_list, encoded.data(), encoded.size());
+    block->channel_list_sequence.store(start + 2, std::memory_order_release);
+    block->channel_list_version.fetch_add(1, std::memory_order_release);
+}
+
+bool transport_read_channel_list(Transport *transport, uint64_t *known_version, std::vector<Game_Channel> *out)
+{
+    Transport_Block *block = transport->block;
+    uint64_t version = block->channel_list_version.load(std::memory_order_acquire);
+    if (version == *known_version)
+        return false;
+
+    std::vector<uint8_t> encoded;
+    for (int attempt = 0; attempt < 16; attempt++)
+    {
+        uint32_t before = block->channel_list_sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+        uint32_t size = std::min(block->channel_list_size, transport_channel_list_capacity);
+        encoded.assign(block->channel_list, block->channel_list + size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (block->channel_list_sequence.load(std::memory_order_relaxed) != before)
+            continue;
+        if (!channel_list_decode(encoded.data(), encoded.size(), out))
+            return false;
+        //a version published during the copy is picked up on the next poll
+        *known_version = version;
+        return true;
+    }
+    return false;
+}
+
+static uint64_t pack_levels(float peak_db, float rms_db)
+{
+    uint32_t peak_bits, rms_bits;
+    std::memcpy(&peak_bits, &peak_db, sizeof(float));
+    std::memcpy(&rms_bits, &rms_db, sizeof(float));
+    return ((uint64_t)peak_bits << 32) | rms_bits;
+}
+
+static void unpack_levels(uint64_t levels, float *peak_db, float *rms_db)
+{
+    uint32_t peak_bits = (uint32_t)(levels >> 32);
+    uint32_t rms_bits = (uint32_t)levels;
+    std::memcpy(peak_db, &peak_bits, sizeof(float));
+    std::memcpy(rms_db, &rms_bits, sizeof(float));
+}
+
+int32_t transport_claim_meter_slot(Transport *transport, uint32_t daw_channel_id)
+{
+    uint64_t key = (uint64_t)daw_channel_id + 1;
+    uint32_t home = (daw_channel_id * 2654435761u) % transport_meter_slot_count;
+    for (uint32_t probe = 0; probe < transport_meter_slot_count; probe++)
+    {
+        uint32_t index = (home + probe) % transport_meter_slot_count;
+        Transport_Meter_Slot *slot = &transport->block->meter_slots[index];
+        uint64_t expected = 0;
+        if (slot->key.compare_exchange_strong(expected, key, std::memory_order_acq_rel))
+        {
+            slot->heartbeat_ms.store(transport_now_ms(), std::memory_order_relaxed);
+            slot->levels.store(pack_levels(-100.0f, -100.0f), std::memory_order_relaxed);
+            return checked_cast<int32_t>(index);
+        }
+    }
+    return -1;
+}
+
+void transport_release_meter_slot(Transport *transport, int32_t slot, uint32_t daw_channel_id)
+{
+    assert(slot >= 0 && slot < (int32_t)transport_meter_slot_count);
+    uint64_t key = (uint64_t)daw_channel_id + 1;
+    transport->block->meter_slots[slot].key.compare_exchange_strong(key, 0, std::memory_order_acq_rel);
+}
+
+bool transport_beat_meter_slot(Transport *transport, int32_t slot, uint32_t daw_channel_id)
+{
+    assert(slot >= 0 && slot < (int32_t)transport_meter_slot_count);
+    Transport_Meter_Slot *meter_slot = &transport->block->meter_slots[slot];
+    if (meter_slot->key.load(std::memory_order_acquire) != (uint64_t)daw_channel_id + 1)
+        return false;
+    meter_slot->heartbeat_ms.store(transport_now_ms(), std::memory_order_relaxed);
+    return true;
+}
+
+void transport_publish_track_level(Transport *transport, int32_t slot, float peak_db, float rms_db)
+{
+    transport->block->meter_slots[slot].levels.store(pack_levels(peak_db, rms_db), std::memory_order_relaxed);
+}
+
+std::vector<Track_Level> transport_read_track_levels(Transport *transport)
+{
+    std::vector<Track_Level> levels;
+    for (uint32_t i = 0; i < transport_meter_slot_count; i++)
+    {
+        const Transport_Meter_Slot &slot = transport->block->meter_slots[i];
+        uint64_t key = slot.key.load(std::memory_order_acquire);
+        if (key == 0)
+            continue;
+        Track_Level level = { .daw_channel_id = (uint32_t)(key - 1) };
+        unpack_levels(slot.levels.load(std::memory_order_relaxed), &level.peak_db, &level.rms_db);
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+uint32_t transport_reclaim_stale_meter_slots(Transport *transport)
+{
+    int64_t now = transport_now_ms();
+    uint32_t reclaimed = 0;
+    for (uint32_t i = 0; i < transport_meter_slot_count; i++)
+    {
+        Transport_Meter_Slot *slot = &transport->block->meter_slots[i];
+        uint64_t key = slot->key.load(std::memory_order_acquire);
+        if (key == 0 || now - slot->heartbeat_ms.load(std::memory_order_relaxed) <= transport_meter_slot_timeout_ms)
+            continue;
+        //a track claiming the slot right now may not have stamped it yet, it loses it and claims another one on its next beat
+        if (slot->key.compare_exchange_strong(key, 0, std::memory_order_acq_rel))
+            reclaimed++;
+    }
+    return reclaimed;
+}
@@ -0,0 +1,203 @@
+//shared memory channel between the host plugin and the track plugins.
+//the MessageManager broadcast only reaches the plugins living in the same process, which isn't the case
+//for hosts that sandbox each plugin, it is kept as the fallback when the shared memory can't be used.
+//
+//tracks -> host : commands, in a bounded lock-free ring (Vyukov), many producers, the host consumes
+//host -> tracks : the dsp state of every game channel, in an open addressing table of seqlocked slots,
+//                 which the tracks read from the audio thread
+//host -> tracks : the game channel list, encoded, seqlocked and versioned, polled by the tracks on the message thread
+//tracks -> host : the level of each track, one slot claimed per track, read by the host at ui rate
+//
+//only a host creates the segment, the tracks attach to it. a host starting over a segment without a live host
+//(crashed, wedged, or from an older build) retires it and creates a new one, the tracks on the retired one
+//reattach from their timer. the host which created the segment unlinks it when it closes
+
+#include <atomic>
+#include <cstring>
+
+enum Transport_Command_Type : uint32_t
+{
+    Transport_Command_None = 0,
+    Transport_Command_Create,
+    Transport_Command_Delete,
+    Transport_Command_Rename,
+    Transport_Command_Frequency_Range,
+    Transport_Command_Select_Game_Channel
+};
+
+struct Transport_Command
+{
+    Transport_Command_Type type;
+    uint32_t daw_channel_id;
+    int64_t game_channel_id;
+    float min_frequency;
+    float max_frequency;
+    char name[128];
+};
+
+enum Transport_Role : uint32_t
+{
+    Transport_Role_Host = 0,
+    Transport_Role_Track
+};
+
+static constexpr uint32_t transport_command_capacity = 4096;
+static constexpr uint32_t transport_dsp_slot_count = 8192;
+static constexpr uint32_t transport_meter_slot_count = 4096;
+//bytes of the encoded channel list, tens of thousands of channels.
+//the segment is only backed by the pages which are written : creating it writes the command ring (640 KB),
+//the dsp and meter slots and the channel list cost what they hold, a short list costs a short list
+static constexpr uint32_t transport_channel_list_capacity = 1 << 20;
+//a host which didn't beat for that long is considered gone, the next host recreates the segment
+static constexpr int64_t transport_host_timeout_ms = 2000;
+//a command slot claimed by a producer and still unfilled after that long belongs to a dead producer
+//a meter slot whose track didn't beat for that long is freed by the host
+static constexpr int64_t transport_meter_slot_timeout_ms = 2000;
+static constexpr int64_t transport_stalled_command_timeout_ms = 1000;
+static_assert((transport_command_capacity & (transport_command_capacity - 1)) == 0);
+static_assert((transport_dsp_slot_count & (transport_dsp_slot_count - 1)) == 0);
+
+//the same atomics are used from several processes, they must not fall back to a lock
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+//the writer is alone, the readers retry when they see a write in progress, or give up after a few tries
+template<typename T>
+static inline void seqlock_write(std::atomic<uint32_t> *sequence, T *destination, const T &value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint32_t start = sequence->load(std::memory_order_relaxed);
+    sequence->store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(destination, &value, sizeof(T));
+    sequence->store(start + 2, std::memory_order_release);
+}
+
+template<typename T>
+static inline bool seqlock_read(const std::atomic<uint32_t> *sequence, const T *source, T *out)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    for (int attempt = 0; attempt < 16; attempt++)
+    {
+        uint32_t before = sequence->load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+        std::memcpy(out, source, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = sequence->load(std::memory_order_relaxed);
+        if (before == after)
+            return true;
+    }
+    return false;
+}
+
+struct Transport_Command_Cell
+{
+    std::atomic<uint64_t> sequence;
+    Transport_Command command;
+};
+
+//the key of a slot whose channel was removed, the probes go past it and a new channel reuses it
+static constexpr uint64_t transport_dsp_slot_removed = UINT64_MAX;
+
+struct Transport_DSP_Slot
+{
+    //game channel id + 1, 0 when empty, transport_dsp_slot_removed
+    std::atomic<uint64_t> key;
+    std::atomic<uint32_t> sequence;
+    Scheduled_DSP_State scheduled;
+};
+
+struct Transport_Meter_Slot
+{
+    //daw channel id + 1, 0 when free
+    std::atomic<uint64_t> key;
+    //peak and rms in dB, packed so that they are written and read together
+    std::atomic<uint64_t> levels;
+    //steady clock ms, written by the track at timer rate, a track process which was killed stops beating
+    std::atomic<int64_t> heartbeat_ms;
+};
+
+struct Track_Level
+{
+    uint32_t daw_channel_id;
+    float peak_db;
+    float rms_db;
+};
+
+struct Transport_Block
+{
+    std::atomic<uint32_t> ready;
+    //set by the host which replaced or closed the segment, everyone still on it reopens
+    std::atomic<uint32_t> is_retired;
+    //steady clock ms, written by the hosts at timer rate
+    std::atomic<int64_t> host_heartbeat_ms;
+
+    alignas(64) std::atomic<uint64_t> command_enqueue_position;
+    alignas(64) std::atomic<uint64_t> command_dequeue_position;
+    Transport_Command_Cell commands[transport_command_capacity];
+
+    Transport_DSP_Slot dsp_slots[transport_dsp_slot_count];
+
+    Transport_Meter_Slot meter_slots[transport_meter_slot_count];
+
+    //checked first, so that an unchanged list isn't copied
+    std::atomic<uint64_t> channel_list_version;
+    std::atomic<uint32_t> channel_list_sequence;
+    //channel_list_encode, only the first channel_list_size bytes are copied
+    uint32_t channel_list_size;
+    uint8_t channel_list[transport_channel_list_capacity];
+};
+
+struct Transport
+{
+    Transport_Block *block;
+    int file_descriptor;
+    //the host which created the segment, it retires and unlinks it when it closes.
+    //the only one which writes the dsp slots and the channel list, the seqlocks have a single writer
+    bool is_owner;
+    //host only, the command slot which was claimed but unfilled at the last pop, see transport_pop_command
+    uint64_t stalled_position;
+    int64_t stalled_since_ms;
+};
+
+//nullptr when the platform has no shared memory, when it couldn't be set up, or for a track, when no host created it yet.
+//never waits, the callers retry from their timer
+std::unique_ptr<Transport> transport_open(Transport_Role role);
+void transport_close(Transport *transport);
+//the segment was replaced or closed by a host, the transport must be closed and opened again
+bool transport_is_retired(Transport *transport);
+#if MIXTRAINER_HEADLESS
+//the bench has a segment of its own, named after its pid. removes it and its lock file, once every transport is closed
+void transport_remove_private_segment();
+#endif
+
+//tracks
+bool transport_push_command(Transport *transport, const Transport_Command &command);
+//audio thread safe, slot_hint caches where the channel was found the last time
+bool transport_read_dsp(Transport *transport, uint32_t game_channel_id, uint32_t *slot_hint, Scheduled_DSP_State *out);
+bool transport_read_channel_list(Transport *transport, uint64_t *known_version, std::vector<Game_Channel> *out);
+//-1 when every slot is taken
+int32_t transport_claim_meter_slot(Transport *transport, uint32_t daw_channel_id);
+//nothing is released when the host reclaimed the slot and another track claimed it since
+void transport_release_meter_slot(Transport *transport, int32_t slot, uint32_t daw_channel_id);
+//at timer rate, false when the host reclaimed the slot, the track then claims a new one
+bool transport_beat_meter_slot(Transport *transport, int32_t slot, uint32_t daw_channel_id);
+//audio thread safe
+void transport_publish_track_level(Transport *transport, int32_t slot, float peak_db, float rms_db);
+
+//host
+//at timer rate, tells the next host that this segment is still in use. only the owner beats
+void transport_host_heartbeat(Transport *transport);
+//false once the owner stopped beating, a second host then closes and opens again to replace the segment.
+//the owner doesn't check its own, a stalled message thread would only make it replace its tracks' segment
+bool transport_is_host_alive(Transport *transport);
+bool transport_pop_command(Transport *transport, Transport_Command *out);
+//owner only, nothing is written by a second host
+void transport_publish_dsp(Transport *transport, uint32_t game_channel_id, const Scheduled_DSP_State &scheduled);
+//the game channel was removed, its slot is reused
+void transport_remove_dsp(Transport *transport, uint32_t game_channel_id);
+void transport_publish_channel_list(Transport *transport, const std::vector<Game_Channel> &channels);
+std::vector<Track_Level> transport_read_track_levels(Transport *transport);
+//at timer rate, frees the slots of the tracks which stopped beating, returns how many
+uint32_t transport_reclaim_stale_meter_slots(Transport *transport);